@@ -0,0 +1,21 @@
+#ifndef BEAM_INTERSECTION_H
+#define BEAM_INTERSECTION_H
+
+namespace dynamic_gap {
+    // Clips beams [begin, end) of a propagated egocircle against a circular agent of radius r
+    // centered at (agent_x, agent_y) in the scan frame. Beam i points along (cos_b[i], sin_b[i]) and
+    // extends to base[i] (the static range); out[i] is lowered to the nearest intersection if the
+    // agent sits between the robot and base[i].
+    //
+    // The arrays are structure-of-arrays so the kernel can run 8 (AVX2) or 16 (AVX-512) beams at a
+    // time. Which path is compiled in is picked at build time with -DDYNAMIC_GAP_SIMD=avx2|avx512,
+    // otherwise the scalar loop is used.
+    void intersectAgentWithBeams(float agent_x, float agent_y, float r,
+                                 const float* cos_b, const float* sin_b, const float* base, float* out,
+                                 int begin, int end);
+
+    // name of the compiled-in path, for logging
+    const char* beamIntersectionKernel();
+}
+
+#endif
@@ -0,0 +1,66 @@
+#ifndef BEAM_TABLE_H
+#define BEAM_TABLE_H
+
+#include <vector>
+
+namespace dynamic_gap {
+    // Per-beam angle and sin/cos lookup for one scan geometry (angle_min, angle_increment, size).
+    // Tables are built once per geometry and kept for the life of the process, so the
+    // references handed out by get()/egocircle() stay valid.
+    class BeamTable {
+        public:
+            BeamTable(double angle_min, double angle_increment, int num_beams);
+
+            ~BeamTable() {};
+
+            // table for beam i at angle_min + i * angle_increment
+            static const BeamTable& get(double angle_min, double angle_increment, int num_beams);
+
+            // table for the gap index convention, beam i at (i - half_scan) / half_scan * pi
+            static const BeamTable& egocircle(int num_beams);
+
+            bool matches(double angle_min, double angle_increment, int num_beams) const {
+                return num_beams == num_beams_ && angle_min == angle_min_ && angle_increment == angle_increment_;
+            }
+
+            int size() const { return num_beams_; }
+
+            // indices outside of [0, size) wrap around the circle
+            int wrap(int i) const {
+                i %= num_beams_;
+                return i < 0 ? i + num_beams_ : i;
+            }
+
+            double angle(int i) const { return angles_[wrap(i)]; }
+            double cosAngle(int i) const { return cos_[wrap(i)]; }
+            double sinAngle(int i) const { return sin_[wrap(i)]; }
+
+            // contiguous single precision copies of the tables, for the SIMD kernels
+            const float* cosData() const { return cosf_.data(); }
+            const float* sinData() const { return sinf_.data(); }
+
+            void toCartesian(int i, float range, float& x, float& y) const {
+                i = wrap(i);
+                x = range * cos_[i];
+                y = range * sin_[i];
+            }
+
+            // converts a whole scan (ranges.size() == size()) into x/y arrays
+            void toCartesian(const std::vector<float>& ranges, std::vector<float>& x, std::vector<float>& y) const;
+
+        private:
+            explicit BeamTable(int num_beams);
+
+            void fillTrig();
+
+            double angle_min_, angle_increment_;
+            int num_beams_;
+            std::vector<double> angles_;
+            std::vector<double> cos_;
+            std::vector<double> sin_;
+            std::vector<float> cosf_;
+            std::vector<float> sinf_;
+    };
+}
+
+#endif
@@ -1,3 +1,6 @@
+#ifndef CART_MODEL_H
+#define CART_MODEL_H
+
 #include <ros/ros.h>
 #include <nav_msgs/Odometry.h>
 #include <geometry_msgs/Twist.h>
@@ -7,13 +10,19 @@
 #include <tf2_ros/transform_listener.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <Eigen/Core>
+#include <dynamic_gap/model_history.h>
 #include <random>
 
 
 using namespace Eigen;
 
 namespace dynamic_gap {
+    class KalmanBatch;
+
     class cart_model {
+        // runs the filter step for many models at once on gathered copies of x, P and G
+        friend class KalmanBatch;
+
         private:
             int n;
             Matrix<double, 2, 4> H; // observation matrix
@@ -52,22 +61,15 @@ namespace dynamic_gap {
             bool initialized;
             double life_time, start_time;
 
-            std::vector< std::vector<double>> previous_states;
-            std::vector< std::vector<double>> previous_measurements;
-            std::vector< std::vector<double>> previous_ego_accels;
-            std::vector< std::vector<double>> previous_ego_vels;
-            bool plotted = false;
+            ModelHistory history; // estimates over the first life_time_threshold seconds, off unless enabled
+            bool history_dumped = false;
             double life_time_threshold;
             Matrix<double, 4, 4> eyes;
             double check_time1;
             Matrix<double, 4, 4> new_P;
             Matrix<double, 2, 2> inverted_tmp_mat;
             Matrix<double, 4, 1> x_update;
-            Matrix<double, 4, 4> Q_1, Q_2, Q_3;
-            std::string plot_dir;
-
-            std::vector< std::vector<double>> agent_odoms;
-            std::vector< std::vector<double>> agent_vels;
+            std::string history_dir;
 
             bool perfect;
             double alpha_R;
@@ -82,24 +84,40 @@ namespace dynamic_gap {
 
             ~cart_model() {};
 
-            Eigen::Vector4d update_ground_truth_cartesian_state();
+            Eigen::Vector4d update_ground_truth_cartesian_state(const std::vector< std::vector<double>> & _agent_odoms,
+                                                                const std::vector< std::vector<double>> & _agent_vels);
             Eigen::Vector4d get_cartesian_state();
             Eigen::Vector4d get_frozen_cartesian_state();
             Eigen::Vector4d get_modified_polar_state();
             Eigen::Vector4d get_frozen_modified_polar_state();
 
             Matrix<double, 3, 1> get_v_ego();
+            // dynamics, state transition matrix and process noise from the last linearize() / discretizeQ()
+            const Matrix<double, 4, 4> & get_A() const { return A; }
+            const Matrix<double, 4, 4> & get_STM() const { return STM; }
+            const Matrix<double, 4, 4> & get_Q() const { return Q; }
+            const Matrix<double, 4, 4> & get_dQ() const { return dQ; }
             void integrate();
             void linearize();
             void discretizeQ();
 
             void frozen_state_propagate(double dt);
             void freeze_robot_vel();
-            void kf_update_loop(Matrix<double, 2, 1> range_bearing_measurement, 
-                                Matrix<double, 1, 3> a_ego, Matrix<double, 1, 3> v_ego, 
+            void kf_update_loop(const Matrix<double, 2, 1> & range_bearing_measurement, 
+                                const Matrix<double, 1, 3> & a_ego, const Matrix<double, 1, 3> & v_ego, 
                                 bool print,
-                                std::vector< std::vector<double>> _agent_odoms,
-                                std::vector< std::vector<double>> _agent_vels);
+                                const std::vector< std::vector<double>> & _agent_odoms,
+                                const std::vector< std::vector<double>> & _agent_vels);
+
+            // the per-model parts of kf_update_loop around the filter step itself: timing, measurement and
+            // ground truth before, history after. Shared with KalmanBatch.
+            void begin_update(const Matrix<double, 2, 1> & range_bearing_measurement, 
+                              const Matrix<double, 1, 3> & a_ego, const Matrix<double, 1, 3> & v_ego, 
+                              bool print,
+                              const std::vector< std::vector<double>> & _agent_odoms,
+                              const std::vector< std::vector<double>> & _agent_vels,
+                              double _t);
+            void end_update();
             void set_side(std::string _side);
             std::string get_side();
             int get_index();
@@ -107,6 +125,13 @@ namespace dynamic_gap {
 
             void set_initialized(bool _initialized);
             bool get_initialized();
-            void plot_states();
+
+            // keep the last depth estimates and write them to <dir>/<index>_<side>.csv once the model
+            // has been tracked for life_time_threshold (no file if dir is empty)
+            void enable_history(int depth, const std::string& dir);
+            void dump_history();
+            const ModelHistory& get_history();
     };
-}
\ No newline at end of file
+}
+
+#endif
@@ -0,0 +1,39 @@
+#ifndef DIST_MATRIX_H
+#define DIST_MATRIX_H
+
+#include <vector>
+
+namespace dynamic_gap {
+    // Row-major distances between current (rows) and previous (columns) gap endpoints. The planner keeps
+    // one per gap set and GapAssociator refills it every scan; the buffer only grows, so a steady gap count
+    // reuses the same block with no per-scan allocation.
+    class DistMatrix {
+        public:
+            DistMatrix() : n_rows(0), n_cols(0) {};
+
+            // contents are unspecified afterwards, every entry is expected to be written
+            void resize(int rows, int cols) {
+                n_rows = rows;
+                n_cols = cols;
+                if (data.size() < (size_t) rows * cols) {
+                    data.resize((size_t) rows * cols);
+                }
+            }
+
+            int rows() const { return n_rows; }
+            int cols() const { return n_cols; }
+            bool empty() const { return n_rows == 0 || n_cols == 0; }
+
+            double& operator()(int i, int j) { return data[(size_t) i * n_cols + j]; }
+            double operator()(int i, int j) const { return data[(size_t) i * n_cols + j]; }
+
+            double* row(int i) { return &data[(size_t) i * n_cols]; }
+            const double* row(int i) const { return &data[(size_t) i * n_cols]; }
+
+        private:
+            std::vector<double> data;
+            int n_rows, n_cols;
+    };
+}
+
+#endif
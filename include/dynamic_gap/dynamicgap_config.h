@@ -43,6 +43,10 @@ namespace dynamic_gap {
 
             struct GapAssociation {
                 double assoc_thresh;
+                int model_history_depth;
+                std::string model_history_dir;
+                bool gated_association;
+                bool angular_association;
             } gap_assoc;
 
             struct ControlParams {
@@ -86,6 +90,7 @@ namespace dynamic_gap {
                 bool far_feasible;
                 int num_feasi_check;
                 int halt_size;
+                bool parallel_traj_gen;
             } planning;
 
             struct Goal {
@@ -98,6 +103,9 @@ namespace dynamic_gap {
                 double scale;
                 double integrate_maxt;
                 double integrate_stept;
+                int integrator;
+                double integrate_abs_tol;
+                double integrate_rel_tol;
                 double rmax;
                 double cobs;
                 double w;
@@ -113,6 +121,12 @@ namespace dynamic_gap {
                 int num_obsts;
             } rbt;
 
+            struct Tracing {
+                bool stage_tracing;
+                double publish_period;
+                std::string dump_file;
+            } tracing;
+
             struct ManualControl {
                 bool man_ctrl;
                 float man_x;
@@ -135,6 +149,10 @@ namespace dynamic_gap {
             gap_viz.debug_viz = true;
 
             gap_assoc.assoc_thresh = 0.5;
+            gap_assoc.model_history_depth = 0;
+            gap_assoc.model_history_dir = "";
+            gap_assoc.gated_association = false;
+            gap_assoc.angular_association = false;
 
             gap_manip.gap_diff = 0.1;
             gap_manip.epsilon1 = 0.18;
@@ -182,6 +200,7 @@ namespace dynamic_gap {
             planning.num_feasi_check = 10;
             planning.far_feasible = false;
             planning.halt_size = 5;
+            planning.parallel_traj_gen = true;
 
             goal.goal_tolerance = 0.2;
             goal.waypoint_tolerance = 0.1;
@@ -190,6 +209,9 @@ namespace dynamic_gap {
             traj.scale = 1;
             traj.integrate_maxt = 5;
             traj.integrate_stept = 0.1;
+            traj.integrator = 0;
+            traj.integrate_abs_tol = 1e-6;
+            traj.integrate_rel_tol = 1e-6;
             traj.rmax = 0.3;
             traj.cobs = -1;
             traj.w = 3;
@@ -199,6 +221,10 @@ namespace dynamic_gap {
             traj.num_curve_points = 10;
             traj.num_qB_points = 5;
 
+            tracing.stage_tracing = false;
+            tracing.publish_period = 1.0;
+            tracing.dump_file = "";
+
             man.man_ctrl = false;
             man.man_x = 0;
             man.man_y = 0;
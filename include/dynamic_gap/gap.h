@@ -10,6 +10,7 @@
 #include <Eigen/Core>
 #include <Eigen/Geometry>
 #include <dynamic_gap/cart_model.h>
+#include <dynamic_gap/beam_table.h>
 
 namespace dynamic_gap
 {
@@ -112,31 +113,34 @@ namespace dynamic_gap
                 convex.terminal_ldist = terminal_ldist;
             }
 
+            // index -> bearing lookup shared by every gap on this egocircle
+            const BeamTable& beams() { return BeamTable::egocircle((int) (2 * half_scan)); }
+
             // Get Left Cartesian Distance
             void getRCartesian(float &x, float &y)
             {
-                x = (_rdist) * cos(-((float) half_scan - _right_idx) / half_scan * M_PI);
-                y = (_rdist) * sin(-((float) half_scan - _right_idx) / half_scan * M_PI);
+                x = (_rdist) * beams().cosAngle(_right_idx);
+                y = (_rdist) * beams().sinAngle(_right_idx);
             }
 
             // Get Right Cartesian Distance
             // edited by Max: float &x, float &y
             void getLCartesian(float &x, float &y)
             {
-                x = (_ldist) * cos(-((float) half_scan - _left_idx) / half_scan * M_PI);
-                y = (_ldist) * sin(-((float) half_scan - _left_idx) / half_scan * M_PI);
+                x = (_ldist) * beams().cosAngle(_left_idx);
+                y = (_ldist) * beams().sinAngle(_left_idx);
             }
 
             void getSimplifiedRCartesian(float &x, float &y){
                 // std::cout << "convex_ldist: " << convex_ldist << ", convex_lidx: " << convex_lidx << ", half_scan: " << half_scan << std::endl;
-                x = (convex.convex_rdist) * cos(-((float) half_scan - convex.convex_ridx) / half_scan * M_PI);
-                y = (convex.convex_rdist) * sin(-((float) half_scan - convex.convex_ridx) / half_scan * M_PI);
+                x = (convex.convex_rdist) * beams().cosAngle(convex.convex_ridx);
+                y = (convex.convex_rdist) * beams().sinAngle(convex.convex_ridx);
             }
 
             void getSimplifiedLCartesian(float &x, float &y){
                 // std::cout << "convex_rdist: " << convex_rdist << ", convex_ridx: " << convex_ridx << ", half_scan: " << half_scan << std::endl;
-                x = (convex.convex_ldist) * cos(-((float) half_scan - convex.convex_lidx) / half_scan * M_PI);
-                y = (convex.convex_ldist) * sin(-((float) half_scan - convex.convex_lidx) / half_scan * M_PI);
+                x = (convex.convex_ldist) * beams().cosAngle(convex.convex_lidx);
+                y = (convex.convex_ldist) * beams().sinAngle(convex.convex_lidx);
             }
 
             // Decimate Gap 
@@ -295,7 +299,8 @@ namespace dynamic_gap
                 if (idx_diff < 0) {
                     idx_diff += (2*half_scan);
                 } 
-                return sqrt(pow(_rdist, 2) + pow(_ldist, 2) - 2 * _rdist * _ldist * (cos(float(idx_diff) / float(half_scan) * M_PI)));
+                // beam (idx_diff + half_scan) sits at idx_diff / half_scan * pi
+                return sqrt(pow(_rdist, 2) + pow(_ldist, 2) - 2 * _rdist * _ldist * beams().cosAngle(idx_diff + (int) half_scan));
             }
 
             void setTerminalPoints(float _terminal_lidx, float _terminal_ldist, float _terminal_ridx, float _terminal_rdist) {
@@ -314,27 +319,27 @@ namespace dynamic_gap
 
                 if (initial) {
                     if (simplified) {
-                        x_r = (_rdist) * cos(-((float) half_scan - _right_idx) / half_scan * M_PI);
-                        y_r = (_rdist) * sin(-((float) half_scan - _right_idx) / half_scan * M_PI);
-                        x_l = (_ldist) * cos(-((float) half_scan - _left_idx) / half_scan * M_PI);
-                        y_l = (_ldist) * sin(-((float) half_scan - _left_idx) / half_scan * M_PI);
+                        x_r = (_rdist) * beams().cosAngle(_right_idx);
+                        y_r = (_rdist) * beams().sinAngle(_right_idx);
+                        x_l = (_ldist) * beams().cosAngle(_left_idx);
+                        y_l = (_ldist) * beams().sinAngle(_left_idx);
                     } else {
-                        x_r = (convex.convex_rdist) * cos(-((float) half_scan - convex.convex_ridx) / half_scan * M_PI);
-                        y_r = (convex.convex_rdist) * sin(-((float) half_scan - convex.convex_ridx) / half_scan * M_PI);
-                        x_l = (convex.convex_ldist) * cos(-((float) half_scan - convex.convex_lidx) / half_scan * M_PI);
-                        y_l = (convex.convex_ldist) * sin(-((float) half_scan - convex.convex_lidx) / half_scan * M_PI);
+                        x_r = (convex.convex_rdist) * beams().cosAngle(convex.convex_ridx);
+                        y_r = (convex.convex_rdist) * beams().sinAngle(convex.convex_ridx);
+                        x_l = (convex.convex_ldist) * beams().cosAngle(convex.convex_lidx);
+                        y_l = (convex.convex_ldist) * beams().sinAngle(convex.convex_lidx);
                     }
                 } else {
                     if (simplified) {
-                        x_r = (terminal_rdist) * cos(-((float) half_scan - terminal_ridx) / half_scan * M_PI);
-                        y_r = (terminal_rdist) * sin(-((float) half_scan - terminal_ridx) / half_scan * M_PI);
-                        x_l = (terminal_ldist) * cos(-((float) half_scan - terminal_lidx) / half_scan * M_PI);
-                        y_l = (terminal_ldist) * sin(-((float) half_scan - terminal_lidx) / half_scan * M_PI);
+                        x_r = (terminal_rdist) * beams().cosAngle(terminal_ridx);
+                        y_r = (terminal_rdist) * beams().sinAngle(terminal_ridx);
+                        x_l = (terminal_ldist) * beams().cosAngle(terminal_lidx);
+                        y_l = (terminal_ldist) * beams().sinAngle(terminal_lidx);
                     } else {
-                        x_r = (convex.terminal_rdist) * cos(-((float) half_scan - convex.terminal_ridx) / half_scan * M_PI);
-                        y_r = (convex.terminal_rdist) * sin(-((float) half_scan - convex.terminal_ridx) / half_scan * M_PI);
-                        x_l = (convex.terminal_ldist) * cos(-((float) half_scan - convex.terminal_lidx) / half_scan * M_PI);
-                        y_l = (convex.terminal_ldist) * sin(-((float) half_scan - convex.terminal_lidx) / half_scan * M_PI);
+                        x_r = (convex.terminal_rdist) * beams().cosAngle(convex.terminal_ridx);
+                        y_r = (convex.terminal_rdist) * beams().sinAngle(convex.terminal_ridx);
+                        x_l = (convex.terminal_ldist) * beams().cosAngle(convex.terminal_lidx);
+                        y_l = (convex.terminal_ldist) * beams().sinAngle(convex.terminal_lidx);
                     }
                 }
 
@@ -14,10 +14,15 @@
 
 #include <dynamic_gap/gap.h>
 #include <dynamic_gap/dynamicgap_config.h>
+#include <dynamic_gap/stage_tracer.h>
+#include <dynamic_gap/model_pool.h>
+#include <dynamic_gap/dist_matrix.h>
 #include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticStatus.h>
 #include <sensor_msgs/LaserScan.h>
 #include <iostream>
 #include <vector>
+#include <atomic>
 
 using namespace std;
 
@@ -25,20 +30,35 @@ namespace dynamic_gap
 {
 	class GapAssociator
 	{
+		// checks the solvers directly on generated distance matrices (test/test_gap_associator.cpp)
+		friend class GapAssociatorSolverTest;
+
 	public:
 		GapAssociator(){};
 		~GapAssociator(){};
 
-		GapAssociator(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg; assoc_thresh = cfg_->gap_assoc.assoc_thresh; };
-		std::vector<int> associateGaps(vector< vector<double> > distMatrix);
-        void assignModels(std::vector<int> association, vector< vector<double> > distMatrix, std::vector<dynamic_gap::Gap>& observed_gaps, std::vector<dynamic_gap::Gap> previous_gaps, Matrix<double, 1, 3> v_ego, int * model_idx);
-		vector<vector<double>> obtainDistMatrix(std::vector<dynamic_gap::Gap> observed_gaps, std::vector<dynamic_gap::Gap> previous_gaps, std::string ns);
+		GapAssociator(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg) : GapAssociator(cfg) {};
+		explicit GapAssociator(const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg; assoc_thresh = cfg_->gap_assoc.assoc_thresh; gated = false; windowed = false; gap_set = 0; for (int s = 0; s < 2; s++) {angular_attempts[s] = 0; angular_fallbacks[s] = 0;} };
+		// completes a windowed distance matrix (gap_assoc.angular_association) before falling back to the full solver
+		std::vector<int> associateGaps(DistMatrix& distMatrix);
+        void assignModels(const std::vector<int>& association, const DistMatrix& distMatrix, std::vector<dynamic_gap::Gap>& observed_gaps, std::vector<dynamic_gap::Gap>& previous_gaps, Matrix<double, 1, 3> v_ego, int * model_idx);
+		void obtainDistMatrix(std::vector<dynamic_gap::Gap>& observed_gaps, std::vector<dynamic_gap::Gap>& previous_gaps, std::string ns, DistMatrix& distMatrix);
+
+		// how often the angular association fast path had to fall back to the solver (gap_assoc.angular_association),
+		// for the raw and the simplified gap sets
+		diagnostic_msgs::DiagnosticStatus associationDiagnostics() const;
 
 
 	private:
 		const DynamicGapConfig* cfg_;
 		double assoc_thresh;
-		double Solve(vector <vector<double> >& DistMatrix, vector<int>& Assignment);
+		double Solve(const DistMatrix& distMatrix, vector<int>& Assignment);
+		void gateDistMatrix(DistMatrix& distMatrix);
+		void fillDistMatrix(DistMatrix& distMatrix);
+		void SolveGated(const DistMatrix& distMatrix, vector<int>& Assignment);
+		bool AngularMatch(const DistMatrix& distMatrix, vector<int>& Assignment);
+		void sortPreviousBearings();
+		void bearingWindow(int i, std::vector<int>& window);
 		void assignmentoptimal(int *assignment, double *cost, double *distMatrix, int nOfRows, int nOfColumns);
 		void buildassignmentvector(int *assignment, bool *starMatrix, int nOfRows, int nOfColumns);
 		void computeassignmentcost(int *assignment, double *cost, double *distMatrix, int nOfRows);
@@ -51,6 +71,27 @@ namespace dynamic_gap
 		std::vector< std::vector<float>> previous_gap_points;
 		std::vector< std::vector<float>> observed_gap_points;
 
+		// gated association (gap_assoc.gated_association): the last distance matrix only holds the pairs that
+		// are within assoc_thresh, row i's are the columns candidate_cols[candidate_start[i] .. candidate_start[i + 1]).
+		// Angular association without gating builds the same windowed matrix, and only measures the remaining
+		// pairs (fillDistMatrix) when the fast path falls back to the Hungarian solver.
+		bool gated;
+		bool windowed;
+		std::vector<int> candidate_start;
+		std::vector<int> candidate_cols;
+
+		std::vector<std::pair<double, int>> previous_bearings; // (bearing, column), sorted
+
+		// gap set of the last distance matrix, 0 raw and 1 simplified
+		int gap_set;
+
+		// per gap set, written by laserScanCB, read when diagnostics are published from the planning loop
+		std::atomic<unsigned long> angular_attempts[2];
+		std::atomic<unsigned long> angular_fallbacks[2];
+
+		// owns every live gap model, a model lives from the scan it first appears in until it is not carried forward
+		ModelPool model_pool;
+
 	};
 }
 
@@ -12,6 +12,7 @@
 #include <Eigen/Geometry>
 #include <sensor_msgs/LaserScan.h>
 #include <boost/shared_ptr.hpp>
+#include <dynamic_gap/scan_view.h>
 
 namespace dynamic_gap {
     class GapFeasibilityChecker {
@@ -20,6 +21,7 @@ namespace dynamic_gap {
             ~GapFeasibilityChecker(){};
 
             GapFeasibilityChecker(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg;};
+            explicit GapFeasibilityChecker(const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg;};
             GapFeasibilityChecker& operator=(GapFeasibilityChecker & other) {cfg_ = other.cfg_;};
             GapFeasibilityChecker(const GapFeasibilityChecker &t) {cfg_ = t.cfg_;};
 
@@ -27,11 +29,11 @@ namespace dynamic_gap {
             bool indivGapFeasibilityCheck(dynamic_gap::Gap& gap);
             double gapSplinecheck(dynamic_gap::Gap & gap, dynamic_gap::cart_model*, dynamic_gap::cart_model*);
             double indivGapFindCrossingPoint(dynamic_gap::Gap & gap, Eigen::Vector2f& gap_crossing_point, dynamic_gap::cart_model*, dynamic_gap::cart_model*);
-            void updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg_);
+            void updateEgoCircle(const ScanView& _scan_view);
             void generateTerminalPoints(dynamic_gap::Gap & gap, double terminal_beta_left, double terminal_reciprocal_range_left, 
                                                                 double terminal_beta_right, double terminal_reciprocal_range_right);
         private:
-            boost::shared_ptr<sensor_msgs::LaserScan const> msg;
+            ScanView scan_view;
             const DynamicGapConfig* cfg_;
             int num_of_scan;
             boost::mutex egolock;
@@ -13,6 +13,7 @@
 #include <Eigen/Geometry>
 #include <sensor_msgs/LaserScan.h>
 #include <boost/shared_ptr.hpp>
+#include <dynamic_gap/scan_view.h>
 
 namespace dynamic_gap {
     class GapManipulator {
@@ -21,15 +22,13 @@ namespace dynamic_gap {
             ~GapManipulator(){};
 
             GapManipulator(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg;};
+            explicit GapManipulator(const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg;};
             GapManipulator& operator=(GapManipulator & other) {cfg_ = other.cfg_;};
             GapManipulator(const GapManipulator &t) {cfg_ = t.cfg_;};
 
-            void updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const>);
+            void updateEgoCircle(const ScanView& _scan_view);
             void updateStaticEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const>);
-            void updateDynamicEgoCircle(std::vector<dynamic_gap::Gap> curr_raw_gaps, 
-                                        dynamic_gap::Gap& gap,
-                                        std::vector<std::vector<double>> & _agent_odoms, 
-                                        std::vector<std::vector<double>> _agent_vels,
+            void updateDynamicEgoCircle(dynamic_gap::Gap& gap,
                                         dynamic_gap::TrajectoryArbiter * trajArbiter);
 
             void setGapWaypoint(dynamic_gap::Gap& gap, geometry_msgs::PoseStamped localgoal, bool initial); //, sensor_msgs::LaserScan const dynamic_laser_scan);
@@ -46,6 +45,7 @@ namespace dynamic_gap {
 
         private:
             boost::shared_ptr<sensor_msgs::LaserScan const> msg, static_msg;
+            ScanView scan_view; // view over msg
             sensor_msgs::LaserScan dynamic_scan;
             const DynamicGapConfig* cfg_;
             int num_of_scan;
@@ -59,7 +59,7 @@ namespace dynamic_gap {
             Eigen::Vector2f car2pol(Eigen::Vector2f);
             Eigen::Vector2f pol2car(Eigen::Vector2f);
             Eigen::Vector2f pTheta(float, float, Eigen::Vector2f, Eigen::Vector2f);
-            bool checkGoalVisibility(geometry_msgs::PoseStamped, float theta_r, float theta_l, float rdist, float ldist, sensor_msgs::LaserScan const scan);
+            bool checkGoalVisibility(geometry_msgs::PoseStamped, float theta_r, float theta_l, float rdist, float ldist, const ScanView& scan);
             bool checkGoalWithinGapAngleRange(dynamic_gap::Gap& gap, double gap_goal_idx, float lidx, float ridx);
             bool feasibilityCheck(dynamic_gap::Gap& gap, dynamic_gap::cart_model*, dynamic_gap::cart_model*);
             double gapSplinecheck(dynamic_gap::Gap& gap, dynamic_gap::cart_model*, dynamic_gap::cart_model*);
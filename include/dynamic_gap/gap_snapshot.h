@@ -0,0 +1,59 @@
+#ifndef GAP_SNAPSHOT_H
+#define GAP_SNAPSHOT_H
+
+#include <map>
+#include <vector>
+#include <ros/ros.h>
+#include <boost/shared_ptr.hpp>
+#include <geometry_msgs/PoseStamped.h>
+#include <dynamic_gap/gap.h>
+#include <dynamic_gap/cart_model.h>
+#include <dynamic_gap/scan_view.h>
+
+namespace dynamic_gap {
+    // Result of one perception cycle (laserScanCB): the associated raw and simplified gaps, their
+    // associations, the scan they were detected in and the local goal at that time.
+    //
+    // The gaps, associations, scan and goal are never modified once published. The gaps point at
+    // private copies of their cart_models, so perception keeps running the live filters while the
+    // planner works off of the copies. Planning does write to those copies, from the planning thread
+    // only and outside of its parallel sections: the side (freezeRawModels) and the frozen state
+    // (freeze_robot_vel, frozen_state_propagate, in gap feasibility and freezeRawModels). The filter
+    // state is never written after publishing, and it is all ctrlGeneration reads from the models of
+    // the executing snapshot (get_cartesian_state), so the control thread does not race planning.
+    // Held by boost::shared_ptr, so a snapshot (and its models) lives for as long as anyone is still
+    // planning or executing off of it.
+    class GapSetSnapshot {
+        public:
+            GapSetSnapshot(const std::vector<dynamic_gap::Gap>& _raw_gaps,
+                           const std::vector<dynamic_gap::Gap>& _observed_gaps,
+                           const std::vector<int>& _raw_association,
+                           const std::vector<int>& _simp_association,
+                           const ScanView& _scan,
+                           const geometry_msgs::PoseStamped& _local_goal,
+                           ros::Time _stamp);
+
+            ~GapSetSnapshot() {};
+
+            // this snapshot's copy of the model with the given index, NULL if the model is gone
+            dynamic_gap::cart_model* findModel(int index) const;
+
+            std::vector<dynamic_gap::Gap> raw_gaps;
+            std::vector<dynamic_gap::Gap> observed_gaps;
+            std::vector<int> raw_association;
+            std::vector<int> simp_association;
+            ScanView scan;
+            geometry_msgs::PoseStamped local_goal; // robot frame
+            ros::Time stamp;
+
+        private:
+            dynamic_gap::cart_model* copyModel(dynamic_gap::cart_model* live,
+                                               std::map<dynamic_gap::cart_model*, dynamic_gap::cart_model*>& copies);
+
+            std::vector<boost::shared_ptr<dynamic_gap::cart_model>> models;
+    };
+
+    typedef boost::shared_ptr<GapSetSnapshot const> GapSetSnapshotConstPtr;
+}
+
+#endif
@@ -12,6 +12,8 @@
 #include <math.h>
 #include <dynamic_gap/gap.h>
 #include <dynamic_gap/dynamicgap_config.h>
+#include <dynamic_gap/stage_tracer.h>
+#include <dynamic_gap/trajectory_2d.h>
 #include <vector>
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/Twist.h>
@@ -35,6 +37,7 @@ namespace dynamic_gap {
             ~TrajectoryGenerator(){};
 
             TrajectoryGenerator(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg;};
+            explicit TrajectoryGenerator(const dynamic_gap::DynamicGapConfig& cfg) {cfg_ = &cfg;};
             TrajectoryGenerator& operator=(TrajectoryGenerator & other) {cfg_ = other.cfg_;};
             TrajectoryGenerator(const TrajectoryGenerator &t) {cfg_ = t.cfg_;};
 
@@ -7,6 +7,8 @@
 #include <dynamic_gap/gap.h>
 #include <boost/shared_ptr.hpp>
 #include <dynamic_gap/dynamicgap_config.h>
+#include <dynamic_gap/scan_view.h>
+#include <dynamic_gap/stage_tracer.h>
 
 namespace dynamic_gap {
     class GapUtils 
@@ -22,14 +24,20 @@ namespace dynamic_gap {
 
         GapUtils(const GapUtils &t) {cfg_ = t.cfg_;};
 
-        std::vector<dynamic_gap::Gap> hybridScanGap(boost::shared_ptr<sensor_msgs::LaserScan const> sharedPtr_laser,
+        // raw and simplified gaps of one scan in a single call
+        void findGaps(const ScanView& scan_view,
+                      geometry_msgs::PoseStamped final_goal_rbt,
+                      std::vector<dynamic_gap::Gap>& raw_gaps,
+                      std::vector<dynamic_gap::Gap>& simplified_gaps);
+
+        std::vector<dynamic_gap::Gap> hybridScanGap(const ScanView& scan_view,
                                                     geometry_msgs::PoseStamped final_goal_rbt);
     
-        std::vector<dynamic_gap::Gap> mergeGapsOneGo(boost::shared_ptr<sensor_msgs::LaserScan const>, std::vector<dynamic_gap::Gap>&);
+        std::vector<dynamic_gap::Gap> mergeGapsOneGo(const ScanView& scan_view, std::vector<dynamic_gap::Gap>&);
 
         std::vector<dynamic_gap::Gap> addTerminalGoal(int, 
                                                       std::vector<dynamic_gap::Gap> &, 
-                                                      sensor_msgs::LaserScan);        
+                                                      const ScanView& scan_view);        
 
         void setMergeThreshold(float);
         void setIdxThreshold(int);
@@ -18,6 +18,7 @@
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 #include <sensor_msgs/LaserScan.h>
 #include <boost/shared_ptr.hpp>
+#include <dynamic_gap/scan_view.h>
 
 namespace dynamic_gap
 {
@@ -32,7 +33,7 @@ namespace dynamic_gap
 
             // Map Frame
             bool setGoal(const std::vector<geometry_msgs::PoseStamped> &);
-            void updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const>);
+            void updateEgoCircle(const ScanView& scan_view);
             void updateLocalGoal(geometry_msgs::TransformStamped map2rbt);
             geometry_msgs::PoseStamped getCurrentLocalGoal(geometry_msgs::TransformStamped rbt2odom);
             geometry_msgs::PoseStamped rbtFrameLocalGoal() {return local_goal;};
@@ -42,7 +43,7 @@ namespace dynamic_gap
 
         private:
             const DynamicGapConfig* cfg_;
-            boost::shared_ptr<sensor_msgs::LaserScan const> sharedPtr_laser;
+            ScanView scan_view;
             std::vector<geometry_msgs::PoseStamped> global_plan;
             std::vector<geometry_msgs::PoseStamped> mod_plan;
             geometry_msgs::PoseStamped local_goal; // Robot Frame
@@ -56,7 +57,7 @@ namespace dynamic_gap
             bool isNotWithin(const double dist);
             // Pose to robot, when all in rbt frames
             double dist2rbt(geometry_msgs::PoseStamped);
-            double scanDistsAtPlanIndices(geometry_msgs::PoseStamped pose, sensor_msgs::LaserScan stored_scan_msgs);
+            double scanDistsAtPlanIndices(geometry_msgs::PoseStamped pose, const sensor_msgs::LaserScan& stored_scan_msgs);
             int PoseIndexInSensorMsg(geometry_msgs::PoseStamped pose);
             double getPoseOrientation(geometry_msgs::PoseStamped);
             bool VisibleOrPossiblyObstructed(geometry_msgs::PoseStamped pose);
@@ -5,6 +5,7 @@
 #include <boost/array.hpp>
 #include <boost/numeric/odeint.hpp>
 #include <vector>
+#include <cmath>
 #include "geometry_msgs/PoseArray.h"
 #include <geometry_msgs/PoseStamped.h>
 #include <geometry_msgs/TransformStamped.h>
@@ -24,6 +25,8 @@
 //#include "osqp.h"
 //#include "/home/masselmeier3/osqp-cpp/include/osqp++.h"
 #include "OsqpEigen/OsqpEigen.h"
+#include <boost/thread/mutex.hpp>
+#include <map>
 
 namespace dynamic_gap {
     typedef boost::array<double, 16> state_type;
@@ -165,6 +168,129 @@ namespace dynamic_gap {
         }
     };
 
+    // Persistent QP used to solve for the reachable gap APF weights. The constraint matrix is always 
+    // dense Kplus1 x Kplus1 and the hessian is identity, so the sparsity pattern only depends on 
+    // num_curve_points/num_qB_points. Solver is only set up again when Kplus1 changes, otherwise 
+    // the constraint values are updated in place. One per thread (trajectories are generated in parallel).
+    struct apf_weight_solver {
+        OsqpEigen::Solver solver;
+        int Kplus1 = -1;
+        Eigen::SparseMatrix<double> hessian, linearMatrix;
+        Eigen::VectorXd gradient, lowerBound, upperBound, zeros;
+
+        bool setup(int _Kplus1) {
+            if (solver.isInitialized()) solver.clearSolver();
+            solver.data()->clearHessianMatrix();
+            solver.data()->clearLinearConstraintsMatrix();
+            Kplus1 = -1;
+
+            hessian.resize(_Kplus1, _Kplus1);
+            hessian.setIdentity();
+
+            // fully dense pattern, stored column-major so that the values of A^T line up with A in row-major order
+            std::vector<Eigen::Triplet<double>> triplets;
+            triplets.reserve(_Kplus1 * _Kplus1);
+            for (int j = 0; j < _Kplus1; j++) {
+                for (int i = 0; i < _Kplus1; i++) {
+                    triplets.push_back(Eigen::Triplet<double>(i, j, 0.0));
+                }
+            }
+            linearMatrix.resize(_Kplus1, _Kplus1);
+            linearMatrix.setFromTriplets(triplets.begin(), triplets.end());
+            linearMatrix.makeCompressed();
+
+            gradient = Eigen::VectorXd::Zero(_Kplus1);
+            zeros = Eigen::VectorXd::Zero(_Kplus1);
+            lowerBound = Eigen::VectorXd::Constant(_Kplus1, -OsqpEigen::INFTY);
+            upperBound = Eigen::VectorXd::Constant(_Kplus1, -0.0000001); // this leads to non-zero weights. Closer to zero this number goes, closer to zero the weights go. This makes sense
+
+            solver.settings()->setVerbosity(false);
+            solver.settings()->setWarmStart(true);
+            solver.data()->setNumberOfVariables(_Kplus1);
+            solver.data()->setNumberOfConstraints(_Kplus1);
+            if(!solver.data()->setHessianMatrix(hessian)) return false; // H ?
+            if(!solver.data()->setGradient(gradient)) return false; // f ?
+            if(!solver.data()->setLinearConstraintsMatrix(linearMatrix)) return false;
+            if(!solver.data()->setLowerBound(lowerBound)) return false;
+            if(!solver.data()->setUpperBound(upperBound)) return false;
+            if(!solver.initSolver()) return false;
+
+            Kplus1 = _Kplus1;
+            return true;
+        }
+
+        // A is (Kplus1, Kplus1), constraint matrix is A^T
+        bool solve(const Eigen::MatrixXd & A, const Eigen::VectorXd * warm_start, Eigen::MatrixXd & weights) {
+            int _Kplus1 = A.rows();
+            if (_Kplus1 != Kplus1 && !setup(_Kplus1)) return false;
+
+            // write values straight into the fixed pattern, no inserts
+            Eigen::Map<Eigen::Matrix<double, Eigen::Dynamic, Eigen::Dynamic, Eigen::RowMajor>>(linearMatrix.valuePtr(), Kplus1, Kplus1) = A;
+            if(!solver.updateLinearConstraintsMatrix(linearMatrix)) return false;
+
+            // the iterates left over from the last solve on this thread belong to an unrelated gap, so every solve
+            // starts from the keyed warm start or from zero and the weights do not depend on thread scheduling
+            bool has_warm_start = (warm_start != NULL && warm_start->size() == Kplus1);
+            if(!solver.setPrimalVariable(has_warm_start ? *warm_start : zeros)) return false;
+            if(!solver.setDualVariable(zeros)) return false;
+
+            // solve the QP problem
+            if(solver.solveProblem() != OsqpEigen::ErrorExitFlag::NoError) return false;
+            weights = solver.getSolution();
+            return true;
+        }
+    };
+
+    inline apf_weight_solver & getThreadAPFWeightSolver() {
+        thread_local apf_weight_solver apf_solver;
+        return apf_solver;
+    }
+
+    // Weights from the previous planning cycle, keyed by the (left, right) model indices of the gap,
+    // used to warm start the next solve for the same associated gap
+    struct apf_warm_start_store {
+        boost::mutex store_mutex;
+        std::map<std::pair<int, int>, Eigen::VectorXd> weights;
+        size_t max_entries = 256;
+
+        bool get(const std::pair<int, int> & key, Eigen::VectorXd & w) {
+            boost::mutex::scoped_lock lock(store_mutex);
+            auto iter = weights.find(key);
+            if (iter == weights.end()) return false;
+            w = iter->second;
+            return true;
+        }
+
+        void set(const std::pair<int, int> & key, const Eigen::VectorXd & w) {
+            boost::mutex::scoped_lock lock(store_mutex);
+            // model indices only ever grow, stale gaps get dropped wholesale
+            if (weights.size() >= max_entries) weights.clear();
+            weights[key] = w;
+        }
+    };
+
+    inline apf_warm_start_store & getAPFWarmStartStore() {
+        static apf_warm_start_store store;
+        return store;
+    }
+
+    // sum over the APF centers of w_i (p - c_i) / (|p - c_i|^2 + eps), with centers and weights as separate
+    // contiguous arrays. K > 0 fixes the number of centers at compile time, K = 0 takes it from n.
+    template <int K>
+    inline Eigen::Vector2d weighted_apf_gradient(const double* cx, const double* cy, const double* w, int n,
+                                                 double px, double py, double eps) {
+        const int num_centers = (K > 0) ? K : n;
+        double gx = 0.0, gy = 0.0;
+        for (int i = 0; i < num_centers; i++) {
+            double dx = px - cx[i];
+            double dy = py - cy[i];
+            double scale = w[i] / (dx * dx + dy * dy + eps);
+            gx += scale * dx;
+            gy += scale * dy;
+        }
+        return Eigen::Vector2d(gx, gy);
+    }
+
     struct reachable_gap_APF {
         Eigen::Vector2d rel_left_vel, rel_right_vel, 
                         goal_pt_0, goal_pt_1;
@@ -180,13 +306,16 @@ namespace dynamic_gap {
                         a_des, a_actual, nom_acc;
         Eigen::Vector4d abs_left_state, abs_right_state, goal_state;
 
-        Eigen::MatrixXd weights, all_centers, all_curve_pts, all_inward_norms, gradient_of_pti_wrt_rbt, test_diff;
-        Eigen::VectorXd rowwise_sq_norms;
+        Eigen::MatrixXd weights, all_centers, all_curve_pts, all_inward_norms;
+        // all_centers and weights packed once for operator(), which then does no allocation
+        std::vector<double> center_x, center_y, center_w;
 
         reachable_gap_APF(Eigen::Vector2d init_rbt_pos, Eigen::Vector2d goal_pt_1, double K_acc,
                           double v_lin_max, Eigen::Vector2d nom_acc, int num_curve_points, int num_qB_points,
-                          Eigen::MatrixXd all_curve_pts, Eigen::MatrixXd all_centers, Eigen::MatrixXd all_inward_norms,
-                          double left_weight, double right_weight, double gap_lifespan) 
+                          const Eigen::MatrixXd & all_curve_pts, const Eigen::MatrixXd & all_centers,
+                          const Eigen::MatrixXd & all_inward_norms,
+                          double left_weight, double right_weight, double gap_lifespan,
+                          std::pair<int, int> warm_start_key = std::make_pair(-1, -1)) 
                           : init_rbt_pos(init_rbt_pos), goal_pt_1(goal_pt_1), K_acc(K_acc), 
                             v_lin_max(v_lin_max), nom_acc(nom_acc), num_curve_points(num_curve_points), num_qB_points(num_qB_points),
                             all_curve_pts(all_curve_pts), all_centers(all_centers), all_inward_norms(all_inward_norms), 
@@ -204,69 +333,34 @@ namespace dynamic_gap {
                             setConstraintMatrix(A, N, Kplus1);
                             ROS_INFO_STREAM("setConstraintMatrix time elapsed: " << (ros::Time::now().toSec() - start_time));
                             // ROS_INFO_STREAM("A: " << A);
-                            
-                            // Eigen::MatrixXd b = Eigen::MatrixXd::Zero(Kplus1, 1);
-
-                            Eigen::SparseMatrix<double> hessian;
-                            hessian.resize(Kplus1, Kplus1);
-
-                            Eigen::VectorXd gradient = Eigen::VectorXd::Zero(Kplus1, 1);
 
-                            Eigen::SparseMatrix<double> linearMatrix; //Kplus1, Kplus1);
-                            linearMatrix.resize(Kplus1, Kplus1);
-
-                            Eigen::VectorXd lowerBound = Eigen::MatrixXd::Zero(Kplus1, 1);
-
-                            Eigen::VectorXd upperBound = Eigen::MatrixXd::Zero(Kplus1, 1);
+                            // warm start from the last weights of the same gap, if there are any
+                            Eigen::VectorXd warm_start;
+                            bool has_warm_start = (warm_start_key.first >= 0 && warm_start_key.second >= 0) && 
+                                                  getAPFWarmStartStore().get(warm_start_key, warm_start);
 
+                            // a failed solve leaves the field at zero weights
+                            center_x.resize(Kplus1);
+                            center_y.resize(Kplus1);
+                            center_w.assign(Kplus1, 0.0);
                             for (int i = 0; i < Kplus1; i++) {
-                                lowerBound(i, 0) = -OsqpEigen::INFTY;
-                                upperBound(i, 0) = -0.0000001; // this leads to non-zero weights. Closer to zero this number goes, closer to zero the weights go. This makes sense
+                                center_x[i] = all_centers(i, 0);
+                                center_y[i] = all_centers(i, 1);
                             }
 
+                            // start_time = ros::Time::now().toSec();
+                            if (!getThreadAPFWeightSolver().solve(A, has_warm_start ? &warm_start : NULL, weights)) return;
                             for (int i = 0; i < Kplus1; i++) {
-                                for (int j = 0; j < Kplus1; j++) {
-                                    if (i == j) {
-                                        hessian.insert(i, j) = 1.0;
-                                    }
-
-                                    // need to transpose A vector, just doing here
-                                    linearMatrix.insert(i, j) = A.coeff(j, i);
-                                }
+                                center_w[i] = weights.coeff(i, 0);
                             }
-
-                            //ROS_INFO_STREAM("Hessian: " << hessian);
-                            //ROS_INFO_STREAM("Gradient: " << gradient);
-                            //ROS_INFO_STREAM("linearMatrix: " << linearMatrix);
-                            //ROS_INFO_STREAM("lowerBound: " << lowerBound);
-                            //ROS_INFO_STREAM("upperBound: " << upperBound);
-
-                            OsqpEigen::Solver solver;
-                            solver.settings()->setVerbosity(false);
-                            solver.settings()->setWarmStart(false);        
-                            solver.data()->setNumberOfVariables(Kplus1);
-                            solver.data()->setNumberOfConstraints(Kplus1);
-                            if(!solver.data()->setHessianMatrix(hessian)) return; // H ?
-                            if(!solver.data()->setGradient(gradient)) return; // f ?
-                            if(!solver.data()->setLinearConstraintsMatrix(linearMatrix)) return;
-                            if(!solver.data()->setLowerBound(lowerBound)) return;
-                            if(!solver.data()->setUpperBound(upperBound)) return;
-
-                            if(!solver.initSolver()) return;
-                            // if(!solver.setPrimalVariable(w_0)) return;
-                            
-                            // solve the QP problem
-                            // start_time = ros::Time::now().toSec();
-                            if(solver.solveProblem() != OsqpEigen::ErrorExitFlag::NoError) return;
-                            // get the controller input
-                            weights = solver.getSolution();
                             // ROS_INFO_STREAM("optimization time elapsed: " << (ros::Time::now().toSec() - start_time));
 
+                            if (warm_start_key.first >= 0 && warm_start_key.second >= 0) {
+                                getAPFWarmStartStore().set(warm_start_key, weights.col(0));
+                            }
+
                             // weights = raw_weights / raw_weights.norm();                                
 
-                            // if(!solver.setPrimalVariable(w_0)) return;
-                            
-                            // solve the QP problem
                             /*
                             ROS_INFO_STREAM("current solution: "); 
                             
@@ -363,6 +457,19 @@ namespace dynamic_gap {
                 return clipped_vel;
             }
         }
+        // weighted_apf_gradient at p, unrolled for the center counts of the default num_curve_points / num_qB_points
+        Eigen::Vector2d weighted_gradient(const Eigen::Vector2d & p) const {
+            const double *cx = center_x.data(), *cy = center_y.data(), *w = center_w.data();
+            switch (Kplus1) {
+                case 31: // 10 curve points and 5 radial extension points a side
+                    return weighted_apf_gradient<31>(cx, cy, w, Kplus1, p[0], p[1], eps);
+                case 21: // 10 curve points a side, no radial extension
+                    return weighted_apf_gradient<21>(cx, cy, w, Kplus1, p[0], p[1], eps);
+                default:
+                    return weighted_apf_gradient<0>(cx, cy, w, Kplus1, p[0], p[1], eps);
+            }
+        }
+
         void operator()(const state_type &x, state_type &dxdt, const double t)
         { 
             state_type new_x = adjust_state(x);
@@ -427,9 +534,6 @@ namespace dynamic_gap {
 
             // Eigen::MatrixXd gradient_of_pti_wrt_centers(Kplus1, 2); // (2, Kplus1); //other one used is Kplus1, 2
    
-            test_diff = (-all_centers).rowwise() + rbt.transpose(); // size Kplus1, 2
-            rowwise_sq_norms = test_diff.rowwise().squaredNorm();
-            gradient_of_pti_wrt_rbt = test_diff.array().colwise() / (rowwise_sq_norms.array() + eps);          
 
             /*
             for (int i = 0; i < Kplus1; i++) {
@@ -470,7 +574,7 @@ namespace dynamic_gap {
             // ROS_INFO_STREAM("total_term: " << total_term[0] << ", " << total_term[1]);
             // rel_goal_pos; // 
             // Eigen::Vector2d v_des = K_att * gradient_of_pti_wrt_centers * weights; // weighted_goal_term + weighted_left_term + weighted_right_term;
-            v_raw = K_att * gradient_of_pti_wrt_rbt.transpose() * weights; // weighted_goal_term + weighted_left_term + weighted_right_term;
+            v_raw = K_att * weighted_gradient(rbt); // weighted_goal_term + weighted_left_term + weighted_right_term;
             // ROS_INFO_STREAM("v_des: " << v_des[0] << ", " << v_des[1]);
 
             v_des = K_des * (v_raw / v_raw.norm());
@@ -578,36 +682,121 @@ namespace dynamic_gap {
         }
     };
 
-    // this is an observer?
+    // Integration output as flat x / y / t buffers. reset() reserves room for the whole horizon up front and
+    // never shrinks, so a buffer that is reused (see getThreadTrajectoryBuffer) stops allocating after its first
+    // trajectory. ROS messages are only built once integration is done, in toPoseArray.
+    struct trajectory_buffer {
+        std::vector<double> x, y, t;
+        state_type last_state; // full state of the last sample, to pick the integration back up from
+
+        void reset(double maxt, double stept) {
+            x.clear();
+            y.clear();
+            t.clear();
+            // integrate_const observes t = 0, stept, ..., plus one for rounding at the end of the horizon
+            size_t steps = (size_t) std::ceil(maxt / stept) + 2;
+            x.reserve(steps);
+            y.reserve(steps);
+            t.reserve(steps);
+        }
+
+        int size() const { return (int) t.size(); }
+
+        void toPoseArray(geometry_msgs::PoseArray& posearr, std::vector<double>& timearr) const {
+            posearr.poses.resize(t.size());
+            for (size_t i = 0; i < t.size(); i++) {
+                geometry_msgs::Pose& pose = posearr.poses[i];
+                pose.position.x = x[i];
+                pose.position.y = y[i];
+                pose.position.z = 0;
+
+                pose.orientation.x = 0;
+                pose.orientation.y = 0;
+                pose.orientation.z = 0;
+                pose.orientation.w = 1;
+            }
+            timearr.assign(t.begin(), t.end());
+        }
+    };
+
+    inline trajectory_buffer & getThreadTrajectoryBuffer() {
+        thread_local trajectory_buffer buffer;
+        return buffer;
+    }
+
+    // odeint observer, only appends to the reserved buffers
     struct write_trajectory
     {
-        geometry_msgs::PoseArray& _posearr;
-        std::string _frame_id;
+        trajectory_buffer& _buffer;
         double _coefs;
-        std::vector<double>& _timearr;
 
-        write_trajectory(geometry_msgs::PoseArray& posearr, std::string frame_id, double coefs, std::vector<double>& timearr)
-        : _posearr(posearr), _frame_id(frame_id), _coefs(coefs), _timearr(timearr) {}
+        write_trajectory(trajectory_buffer& buffer, double coefs)
+        : _buffer(buffer), _coefs(coefs) {}
 
         void operator()( const state_type &x , double t )
         {
-            geometry_msgs::PoseStamped pose;
-            pose.header.frame_id = _frame_id;
             // if this _coefs is not 1.0, will cause jump between initial and next poses
-            pose.pose.position.x = x[0] / _coefs;
-            pose.pose.position.y = x[1] / _coefs;
-            pose.pose.position.z = 0;
+            _buffer.x.push_back(x[0] / _coefs);
+            _buffer.y.push_back(x[1] / _coefs);
+            _buffer.t.push_back(t);
+            _buffer.last_state = x;
+        }
+    };
+
+    // traj.integrator
+    enum trajectory_integrator {EULER_INTEGRATOR = 0, RK4_INTEGRATOR = 1, DOPRI5_INTEGRATOR = 2};
+
+    // Hands a system to odeint by reference and zeroes the derivative before each evaluation. The systems above
+    // only write the components they drive, which is fine for euler but not for the error estimate of DOPRI5.
+    template <class System>
+    struct full_derivative
+    {
+        System& _system;
 
-            pose.pose.orientation.x = 0;
-            pose.pose.orientation.y = 0;
-            pose.pose.orientation.z = 0;
-            pose.pose.orientation.w = 1;
-            _posearr.poses.push_back(pose.pose);
+        full_derivative(System& system) : _system(system) {}
 
-            _timearr.push_back(t);
+        void operator()(const state_type &x, state_type &dxdt, const double t)
+        {
+            dxdt.fill(0.0);
+            _system(x, dxdt, t);
         }
     };
 
+    // Integrates system over [0, maxt], observed every stept. Euler and RK4 step on that grid, DOPRI5 picks its
+    // own steps under abs_tol / rel_tol and its dense output is sampled on the grid. Fields that switch back and
+    // forth (hovering on a goal) stall the step size control, so once DOPRI5 needs more than 20 steps between
+    // two grid points the rest of the horizon is integrated with RK4 on the grid, from the last sample.
+    template <class System>
+    void integrate_trajectory(System& system, state_type& x, double maxt, double stept,
+                              int integrator, double abs_tol, double rel_tol, write_trajectory& observer)
+    {
+        namespace odeint = boost::numeric::odeint;
+        full_derivative<System> rhs(system);
+        if (integrator == RK4_INTEGRATOR) {
+            odeint::integrate_const(odeint::runge_kutta4<state_type>(), rhs, x, 0.0, maxt, stept, observer);
+        } else if (integrator == DOPRI5_INTEGRATOR) {
+            state_type x0 = x;
+            try {
+                odeint::integrate_const(odeint::make_dense_output(abs_tol, rel_tol, odeint::runge_kutta_dopri5<state_type>()),
+                                        rhs, x, 0.0, maxt, stept, observer, odeint::max_step_checker(20));
+            } catch (odeint::no_progress_error &) {
+                trajectory_buffer& buffer = observer._buffer;
+                if (buffer.size() == 0) {
+                    observer(x0, 0.0);
+                }
+                ROS_WARN_STREAM("integrate_trajectory: DOPRI5 stalled after t = " << buffer.t.back() << ", RK4 up to " << maxt);
+                x = buffer.last_state;
+                odeint::runge_kutta4<state_type> rk4;
+                for (int i = buffer.size(); i * stept <= maxt + 1e-6 * stept; i++) {
+                    rk4.do_step(rhs, x, (i - 1) * stept, stept);
+                    observer(x, i * stept);
+                }
+            }
+        } else {
+            odeint::integrate_const(odeint::euler<state_type>(), rhs, x, 0.0, maxt, stept, observer);
+        }
+    }
+
 }
 
 #endif
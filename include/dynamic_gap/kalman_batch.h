@@ -0,0 +1,53 @@
+#ifndef KALMAN_BATCH_H
+#define KALMAN_BATCH_H
+
+#include <vector>
+#include <Eigen/Core>
+#include <dynamic_gap/cart_model.h>
+
+namespace dynamic_gap {
+    // Runs the cart_model filter step for every queued gap endpoint in one pass. The state, covariance and
+    // gain of each model are gathered into per-entry lanes (one contiguous array per matrix element), the
+    // state/covariance propagation and measurement update run as a single loop over the lanes, and the
+    // results are written back to the models. All models in a pass share the ego velocity, acceleration
+    // and timestamp, and each model gets exactly the arithmetic of cart_model::kf_update_loop, so the batch
+    // is a drop-in replacement for updating the models one by one. The lane arrays are kept between passes.
+    class KalmanBatch {
+        public:
+            KalmanBatch() {};
+
+            // queues a model for the next update(), range_bearing_measurement is (range, bearing) in the robot frame
+            void add(dynamic_gap::cart_model* model, const Matrix<double, 2, 1> & range_bearing_measurement);
+
+            // updates every queued model with its measurement, all stamped t, and empties the queue
+            void update(const Matrix<double, 1, 3> & a_ego, const Matrix<double, 1, 3> & v_ego,
+                        const std::vector< std::vector<double>> & agent_odoms,
+                        const std::vector< std::vector<double>> & agent_vels,
+                        double t);
+
+            int size() const { return (int) models.size(); }
+
+        private:
+            void gather(const Matrix<double, 1, 3> & a_ego, const Matrix<double, 1, 3> & v_ego,
+                        const std::vector< std::vector<double>> & agent_odoms,
+                        const std::vector< std::vector<double>> & agent_vels,
+                        double t);
+            void propagate(double ang_vel_ego, double vdot_x_body, double vdot_y_body);
+            void scatter();
+
+            std::vector<dynamic_gap::cart_model*> models;
+            std::vector<double> ranges, bearings;
+
+            // lanes, element (i, j) of a matrix lives in [i*cols + j][entry]
+            std::vector<double> x[4];
+            std::vector<double> P[16];
+            std::vector<double> G[8];
+            std::vector<double> R[4];
+            std::vector<double> x_tilde[2];
+            std::vector<double> dt;
+            std::vector<double> cos_w_dt, sin_w_dt; // the distinct entries of STM
+            std::vector<double> dQ_0[3], dQ_1[3], dQ_2[3]; // the 2x2 blocks of dQ, (0,0), (0,1), (1,1) each
+    };
+}
+
+#endif
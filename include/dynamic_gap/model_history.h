@@ -0,0 +1,44 @@
+#ifndef MODEL_HISTORY_H
+#define MODEL_HISTORY_H
+
+#include <string>
+#include <vector>
+#include <Eigen/Core>
+
+namespace dynamic_gap {
+    // Fixed-depth record of a gap model's estimates, for offline estimator analysis. Records live in one
+    // flat array (STRIDE doubles each) used as a ring buffer, so a model's memory stays constant no matter
+    // how long it is tracked, and copying a model copies the history in one block. Depth 0 (the default)
+    // records nothing.
+    //
+    // Record layout: t, x[4] (estimate), x_gt[4] (ground truth / measurement), v_ego[3], a_ego[3]
+    class ModelHistory {
+        public:
+            static const int STRIDE = 15;
+
+            ModelHistory() : depth(0), head(0), count(0) {};
+
+            // clears the history and keeps at most _depth records from here on
+            void setDepth(int _depth);
+
+            bool enabled() const { return depth > 0; }
+            int size() const { return count; }
+
+            void push(double t, const Eigen::Vector4d& x, const Eigen::Vector4d& x_gt,
+                      const Eigen::Matrix<double, 1, 3>& v_ego, const Eigen::Matrix<double, 1, 3>& a_ego);
+
+            // i = 0 is the oldest record kept
+            const double* record(int i) const { return &data[((head + depth - count + i) % depth) * STRIDE]; }
+
+            // writes the records, oldest first, as CSV with a header row
+            bool dump(const std::string& path) const;
+
+        private:
+            int depth;
+            int head; // slot the next record goes into
+            int count;
+            std::vector<double> data;
+    };
+}
+
+#endif
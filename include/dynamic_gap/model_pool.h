@@ -0,0 +1,47 @@
+#ifndef MODEL_POOL_H
+#define MODEL_POOL_H
+
+#include <string>
+#include <vector>
+#include <type_traits>
+#include <Eigen/Core>
+#include <dynamic_gap/cart_model.h>
+
+namespace dynamic_gap {
+    // Fixed-slot arena for gap endpoint models. Slots are carved out of chunks that are never moved or
+    // freed while the pool lives, so a cart_model* handed out by acquire() is a stable handle until it is
+    // given back with release(). Released slots are reused (most recently released first) before the pool
+    // grows by another chunk, so a steady gap count settles at a fixed footprint with no allocator traffic
+    // for the models themselves. Not thread safe, models are only created and retired in laserScanCB.
+    class ModelPool {
+        public:
+            explicit ModelPool(int _chunk_size = 64);
+
+            ~ModelPool();
+
+            dynamic_gap::cart_model* acquire(std::string side, int index, double init_r, double init_beta, Matrix<double, 1, 3> v_ego);
+            void release(dynamic_gap::cart_model* model);
+
+            int live() const { return num_live; }
+            int capacity() const { return (int) chunks.size() * chunk_size; }
+
+        private:
+            struct Slot {
+                // storage must stay the first member, models are mapped back to their slot by address
+                typename std::aligned_storage<sizeof(dynamic_gap::cart_model), alignof(dynamic_gap::cart_model)>::type storage;
+                bool live;
+            };
+
+            ModelPool(const ModelPool&);
+            ModelPool& operator=(const ModelPool&);
+
+            void grow();
+
+            int chunk_size;
+            int num_live;
+            std::vector<Slot*> chunks;
+            std::vector<Slot*> free_slots;
+    };
+}
+
+#endif
@@ -21,6 +21,12 @@
 #include <dynamic_gap/gap.h>
 // #include <dynamic_gap/trajectory_follower.h>
 #include <dynamic_gap/gap_utils.h>
+#include <dynamic_gap/scan_view.h>
+#include <dynamic_gap/gap_snapshot.h>
+#include <dynamic_gap/planning_steps.h>
+#include <dynamic_gap/kalman_batch.h>
+#include <dynamic_gap/trajectory_2d.h>
+#include <dynamic_gap/stage_tracer.h>
 
 #include <dynamic_gap/dynamicgap_config.h>
 #include <dynamic_gap/visualization.h>
@@ -78,6 +84,7 @@ namespace dynamic_gap
         ros::Publisher ni_traj_pub_other;
 
         ros::Publisher dyn_egocircle_pub;
+        ros::Publisher stage_latency_pub;
         
         ros::Subscriber rbt_accel_sub;
         ros::Subscriber agent0_vel_sub;
@@ -87,8 +94,9 @@ namespace dynamic_gap
         std::vector<int> simp_association;
         std::vector<int> raw_association;
 
-        vector< vector<double> > simp_distMatrix;
-        vector< vector<double> > raw_distMatrix;
+        // refilled every scan, kept so the buffers are reused
+        dynamic_gap::DistMatrix simp_distMatrix;
+        dynamic_gap::DistMatrix raw_distMatrix;
 
         bool print_associations;
 
@@ -129,6 +137,7 @@ namespace dynamic_gap
         dynamic_gap::TrajectoryController *trajController;
         dynamic_gap::GapAssociator *gapassociator;
         dynamic_gap::GapFeasibilityChecker *gapFeasibilityChecker;
+        dynamic_gap::KalmanBatch kf_batch; // gap endpoint model updates of one update_models call
 
         // Status
         bool hasGoal = false;
@@ -145,6 +154,7 @@ namespace dynamic_gap
         boost::shared_ptr<sensor_msgs::LaserScan const> static_scan_ptr;
         boost::shared_ptr<sensor_msgs::LaserScan const> sharedPtr_laser;
         boost::shared_ptr<sensor_msgs::LaserScan const> sharedPtr_inflatedlaser;
+        dynamic_gap::RangeMinIndexPool scan_index_pool; // indexes of the scan views laserScanCB builds, under gapset_mutex
 
         ros::WallTime last_time;
         dynamic_gap::TrajPlan ni_ref, orig_ref;
@@ -157,10 +167,14 @@ namespace dynamic_gap
         
         dynamic_gap::DynamicGapConfig cfg;
 
-        boost::mutex gapset_mutex;
+        boost::mutex gapset_mutex; // perception state only, planning reads gapset_snapshot
 
-        geometry_msgs::PoseArray curr_executing_traj;
-        std::vector<double> curr_executing_time_arr;
+        // latest gap set published by laserScanCB, swapped in and read with boost::atomic_store/atomic_load
+        dynamic_gap::GapSetSnapshotConstPtr gapset_snapshot;
+        // snapshot that curr_right_model/curr_left_model live in
+        dynamic_gap::GapSetSnapshotConstPtr exec_snapshot;
+
+        dynamic_gap::Trajectory2D curr_executing_traj; // odom frame
         int curr_exec_left_idx;
         int curr_exec_right_idx;
 
@@ -180,6 +194,7 @@ namespace dynamic_gap
         int init_val;
         int * model_idx;
         double prev_traj_switch_time;
+        double prev_trace_pub_time;
         double init_time;
 
         dynamic_gap::cart_model * curr_right_model;
@@ -283,16 +298,17 @@ namespace dynamic_gap
         
         /**
          * Take current observed gaps and perform gap conversion
-         * @param None, directly taken from private variable space
+         * @param _observed_gaps feasible gaps of the snapshot
+         * @param snapshot gap set being planned on
          * @return gap_set, simplfied radial prioritized gaps
          */
-        std::vector<dynamic_gap::Gap> gapManipulate(std::vector<dynamic_gap::Gap> _observed_gaps);
+        std::vector<dynamic_gap::Gap> gapManipulate(std::vector<dynamic_gap::Gap> _observed_gaps, const dynamic_gap::GapSetSnapshot& snapshot);
 
         /**
          * 
          *
          */
-        std::vector<std::vector<double>> initialTrajGen(std::vector<dynamic_gap::Gap>& vec, std::vector<geometry_msgs::PoseArray>& res, std::vector<std::vector<double>>& res_time_traj);
+        std::vector<std::vector<double>> initialTrajGen(std::vector<dynamic_gap::Gap>& vec, std::vector<dynamic_gap::Trajectory2D>& res, const dynamic_gap::GapSetSnapshot& snapshot);
 
         /**
          * Callback function to config object
@@ -303,27 +319,25 @@ namespace dynamic_gap
 
         /**
          * Pick the best trajectory from the current set
-         * @param Vector of PoseArray
+         * @param Vector of trajectories
          * @param Vector of corresponding trajectory scores
          * @return the best trajectory
          */
-        int pickTraj(std::vector<geometry_msgs::PoseArray> prr, std::vector<std::vector<double>> score);
+        int pickTraj(const std::vector<dynamic_gap::Trajectory2D>& prr, std::vector<std::vector<double>> score);
 
         /**
          * Compare to the old trajectory and pick the best one
-         * @param incoming trajectory
-         * @return the best trajectory  
+         * @param incoming trajectory, odom frame
+         * @param incoming trajectory's scores from initialTrajGen
+         * @return the best trajectory, as published (odom frame)
          */
-        geometry_msgs::PoseArray compareToOldTraj(geometry_msgs::PoseArray incoming, dynamic_gap::Gap incoming_gap, std::vector<dynamic_gap::Gap> feasible_gaps, std::vector<double> time_arr);
+        geometry_msgs::PoseArray compareToOldTraj(dynamic_gap::Trajectory2D incoming, dynamic_gap::Gap incoming_gap, std::vector<dynamic_gap::Gap> feasible_gaps, const std::vector<double>& incom_score, const dynamic_gap::GapSetSnapshot& snapshot);
 
         /**
          * Setter and Getter of Current Trajectory, this is performed in the compareToOldTraj function
          */
-        void setCurrentTraj(geometry_msgs::PoseArray);        
-        geometry_msgs::PoseArray getCurrentTraj();
-
-        void setCurrentTimeArr(std::vector<double>);
-        std::vector<double> getCurrentTimeArr();
+        void setCurrentTraj(dynamic_gap::Trajectory2D);        
+        dynamic_gap::Trajectory2D getCurrentTraj();
 
         int getCurrentRightGapIndex();
         int getCurrentLeftGapIndex();
@@ -354,7 +368,7 @@ namespace dynamic_gap
          */
         bool recordAndCheckVel(geometry_msgs::Twist cmd_vel);
     
-        void update_model(int i, std::vector<dynamic_gap::Gap>& _observed_gaps, Matrix<double, 1, 3> _v_ego, Matrix<double, 1, 3> _a_ego, bool print);
+        void update_model(int i, std::vector<dynamic_gap::Gap>& _observed_gaps, Matrix<double, 1, 3> _v_ego, Matrix<double, 1, 3> _a_ego);
         std::vector<dynamic_gap::Gap> update_models(std::vector<dynamic_gap::Gap> _observed_gaps, Matrix<double, 1, 3> _v_ego, Matrix<double, 1, 3> _a_ego, bool print);
         std::vector<dynamic_gap::Gap> get_curr_raw_gaps();
         std::vector<dynamic_gap::Gap> get_curr_observed_gaps();
@@ -371,11 +385,23 @@ namespace dynamic_gap
 
         std::vector<int> get_simplified_associations();
 
-        std::vector<dynamic_gap::Gap> gapSetFeasibilityCheck();
+        std::vector<dynamic_gap::Gap> gapSetFeasibilityCheck(const dynamic_gap::GapSetSnapshot& snapshot);
+
+        /**
+         * Latest gap set published by laserScanCB, never blocks on perception
+         * @return snapshot, NULL before the first scan
+         */
+        dynamic_gap::GapSetSnapshotConstPtr getGapSetSnapshot();
 
         void agentOdomCB(const nav_msgs::Odometry::ConstPtr& msg);
         void visualizeComponents(std::vector<dynamic_gap::Gap> manip_gap_set);
 
+        /**
+         * Publish per-stage latency histograms (and write them to the dump file) and the angular association
+         * fallback rate, at most once per publish period
+         */
+        void publishStageLatency();
+
         int get_num_obsts();
 
     };
@@ -0,0 +1,69 @@
+#ifndef PLANNING_STEPS_H
+#define PLANNING_STEPS_H
+
+#include <string>
+#include <tuple>
+#include <vector>
+#include <Eigen/Core>
+#include <geometry_msgs/PoseArray.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/Twist.h>
+
+#include <dynamic_gap/gap.h>
+#include <dynamic_gap/scan_view.h>
+#include <dynamic_gap/dist_matrix.h>
+#include <dynamic_gap/gap_associator.h>
+#include <dynamic_gap/kalman_batch.h>
+#include <dynamic_gap/gap_feasibility.h>
+#include <dynamic_gap/gap_manip.h>
+#include <dynamic_gap/gap_trajectory_generator.h>
+#include <dynamic_gap/trajectory_scoring.h>
+
+namespace dynamic_gap {
+    // Perception and planning steps of one scan / one planning cycle, shared by Planner (laserScanCB,
+    // getPlanTrajectory) and dynamic_gap_bench so the bench times the code the planner runs. The caller
+    // owns every piece of state, these only sequence the subsystems.
+
+    // Associates one gap set (raw or simplified, ns) with the previous scan's and carries the models over
+    void associateGapSet(GapAssociator& associator, std::vector<dynamic_gap::Gap>& gaps,
+                         std::vector<dynamic_gap::Gap>& previous_gaps, const std::string& ns,
+                         DistMatrix& distMatrix, std::vector<int>& association,
+                         const Matrix<double, 1, 3>& v_ego, int* model_idx);
+
+    // (range, bearing) of a gap endpoint as seen from the robot
+    Matrix<double, 2, 1> gapEndpointMeasurement(dynamic_gap::Gap& gap, bool right,
+                                                const geometry_msgs::PoseStamped& rbt_in_cam);
+
+    // Filters both endpoint models of every gap in one batch, all stamped t
+    void updateGapModels(std::vector<dynamic_gap::Gap>& gaps, const geometry_msgs::PoseStamped& rbt_in_cam,
+                         KalmanBatch& kf_batch, const Matrix<double, 1, 3>& a_ego, const Matrix<double, 1, 3>& v_ego,
+                         const std::vector<std::vector<double>>& agent_odom_vects,
+                         const std::vector<std::vector<double>>& agent_vel_vects, double t);
+
+    // Points feasibility, manipulation and scoring at the egocircle of the gap set being planned on
+    void updatePlanningEgoCircle(const ScanView& scan, TrajectoryArbiter& arbiter, GapManipulator& manip,
+                                 GapFeasibilityChecker& feasibility);
+
+    // Gaps of observed_gaps that pass the feasibility check, with their terminal right information
+    std::vector<dynamic_gap::Gap> feasibleGaps(GapFeasibilityChecker& feasibility,
+                                               std::vector<dynamic_gap::Gap> observed_gaps);
+
+    // Builds the cycle's propagated egocircles, then manipulates every gap at t = 0 and at its terminal time
+    void manipulateGaps(GapManipulator& manip, TrajectoryArbiter& arbiter, std::vector<dynamic_gap::Gap>& gaps,
+                        const geometry_msgs::PoseStamped& local_goal,
+                        const std::vector<std::vector<double>>& agent_odom_vects,
+                        const std::vector<std::vector<double>>& agent_vel_vects);
+
+    // Every gap gets an ahpf trajectory, gaps with the goal within (or artificial) also a g2g one, and the
+    // better scoring of the two is kept: trajs[i] (robot frame) and scores[i]. The (g2g, ahpf) tasks run
+    // under OpenMP when parallel is set.
+    void generateGapTrajectories(GapTrajGenerator& traj_gen, TrajectoryArbiter& arbiter, std::vector<dynamic_gap::Gap>& gaps,
+                                 const geometry_msgs::PoseStamped& rbt_in_cam, const geometry_msgs::Twist& rbt_vel,
+                                 std::vector<dynamic_gap::Gap> raw_gaps,
+                                 const std::vector<std::vector<double>>& agent_odom_vects,
+                                 const std::vector<std::vector<double>>& agent_vel_vects, bool parallel,
+                                 std::vector<std::tuple<geometry_msgs::PoseArray, std::vector<double>>>& trajs,
+                                 std::vector<std::vector<double>>& scores);
+}
+
+#endif
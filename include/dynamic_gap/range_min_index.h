@@ -0,0 +1,84 @@
+#ifndef RANGE_MIN_INDEX_H
+#define RANGE_MIN_INDEX_H
+
+#include <vector>
+#include <algorithm>
+#include <cstdint>
+#include <boost/shared_ptr.hpp>
+
+namespace dynamic_gap {
+    // Constant time minimum queries over any run of one scan's beams, built in O(n). The beams are cut
+    // into blocks of 32: a sparse table over the block minima answers the whole blocks of a query, and
+    // within a block every beam keeps a bit mask of the increasing stack ending at it (the beams with no
+    // smaller range after them), so the minimum of a partial block is the lowest stack bit at or after
+    // its start. The table covers n / 32 blocks, so it stays under n entries.
+    // The minimum and maximum of the whole scan are taken while copying the ranges in. Rebuilding keeps the
+    // storage, so an index rebuilt for a scan of the same size does not allocate.
+    class RangeMinIndex {
+        public:
+            RangeMinIndex() : n(0), num_blocks(0), min_value(0), max_value(0) {};
+
+            void build(const std::vector<float>& ranges);
+
+            int size() const { return n; }
+
+            // minimum over the half-open range [lo, hi), 0 <= lo < hi <= size()
+            float min(int lo, int hi) const {
+                int last = hi - 1;
+                int lo_block = lo >> BLOCK_SHIFT, last_block = last >> BLOCK_SHIFT;
+                if (lo_block == last_block) {
+                    return blockMin(lo, last);
+                }
+                float result = std::min(blockMin(lo, (lo_block << BLOCK_SHIFT) + BLOCK_SIZE - 1),
+                                        blockMin(last_block << BLOCK_SHIFT, last));
+                if (lo_block + 1 < last_block) {
+                    int b_lo = lo_block + 1, b_hi = last_block;
+                    int k = log2(b_hi - b_lo);
+                    result = std::min(result, std::min(table[k*num_blocks + b_lo], table[k*num_blocks + b_hi - (1 << k)]));
+                }
+                return result;
+            }
+
+            float minValue() const { return min_value; }
+            float maxValue() const { return max_value; }
+
+        private:
+            static const int BLOCK_SHIFT = 5;
+            static const int BLOCK_SIZE = 1 << BLOCK_SHIFT;
+
+            static int log2(int len) { return 31 - __builtin_clz((unsigned) len); }
+
+            // minimum over beams lo, ..., last of one block
+            float blockMin(int lo, int last) const {
+                uint32_t stack = masks[last] & (~0u << (lo & (BLOCK_SIZE - 1)));
+                return values[(lo & ~(BLOCK_SIZE - 1)) + __builtin_ctz(stack)];
+            }
+
+            int n, num_blocks;
+            std::vector<float> values;
+            std::vector<uint32_t> masks;
+            std::vector<float> table; // block level k at [k*num_blocks, k*num_blocks + num_blocks - 2^k]
+            float min_value, max_value;
+    };
+
+    // Hands out indexes for new scan views. An index comes back to the pool once no view holds it, so with
+    // the few views alive at a time (the current scan, the planning snapshot) steady scans reuse the same
+    // indexes. Not thread safe, acquire from one thread.
+    class RangeMinIndexPool {
+        public:
+            boost::shared_ptr<RangeMinIndex> acquire() {
+                for (const boost::shared_ptr<RangeMinIndex> & index : indexes) {
+                    if (index.unique()) {
+                        return index;
+                    }
+                }
+                indexes.push_back(boost::shared_ptr<RangeMinIndex>(new RangeMinIndex));
+                return indexes.back();
+            }
+
+        private:
+            std::vector<boost::shared_ptr<RangeMinIndex> > indexes;
+    };
+}
+
+#endif
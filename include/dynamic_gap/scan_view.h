@@ -0,0 +1,69 @@
+#ifndef SCAN_VIEW_H
+#define SCAN_VIEW_H
+
+#include <vector>
+#include <string>
+#include <sensor_msgs/LaserScan.h>
+#include <boost/shared_ptr.hpp>
+#include <dynamic_gap/beam_table.h>
+#include <dynamic_gap/range_min_index.h>
+
+namespace dynamic_gap {
+    // Read-only view over a received egocircle. Holds the message by shared pointer
+    // (never copies the ranges) together with the beam table for its geometry and a
+    // range minimum index built once with the view, so it can be handed to every
+    // subsystem by const reference. Copying a view only copies pointers.
+    class ScanView {
+        public:
+            ScanView() : table_(NULL) {};
+            explicit ScanView(boost::shared_ptr<sensor_msgs::LaserScan const> msg);
+            // builds into an index from pool rather than a new one
+            ScanView(boost::shared_ptr<sensor_msgs::LaserScan const> msg, RangeMinIndexPool& pool);
+
+            ~ScanView() {};
+
+            bool valid() const { return (bool) msg_; }
+            boost::shared_ptr<sensor_msgs::LaserScan const> ptr() const { return msg_; }
+            const sensor_msgs::LaserScan& scan() const { return *msg_; }
+
+            const std::vector<float>& ranges() const { return msg_->ranges; }
+            float range(int i) const { return msg_->ranges[i]; }
+            int size() const { return (int) msg_->ranges.size(); }
+            int halfScan() const { return size() / 2; }
+            const std::string& frame() const { return msg_->header.frame_id; }
+            float angleMin() const { return msg_->angle_min; }
+            float angleIncrement() const { return msg_->angle_increment; }
+
+            // smallest and largest range of the whole scan
+            float minRange() const { return index_->minValue(); }
+            float maxRange() const { return index_->maxValue(); }
+
+            // minimum over beams lo, ..., hi - 1 going around the circle, so the span may start
+            // or end outside of [0, size()), 0 < hi - lo <= size()
+            float minRange(int lo, int hi) const {
+                int n = size();
+                int span = hi - lo;
+                lo = table_->wrap(lo);
+                if (lo + span <= n) {
+                    return index_->min(lo, lo + span);
+                }
+                return std::min(index_->min(lo, n), index_->min(0, lo + span - n));
+            }
+
+            const RangeMinIndex& rangeIndex() const { return *index_; }
+
+            const BeamTable& beams() const { return *table_; }
+            double angle(int i) const { return table_->angle(i); }
+            double cosAngle(int i) const { return table_->cosAngle(i); }
+            double sinAngle(int i) const { return table_->sinAngle(i); }
+
+        private:
+            void build(boost::shared_ptr<RangeMinIndex> index);
+
+            boost::shared_ptr<sensor_msgs::LaserScan const> msg_;
+            const BeamTable* table_;
+            boost::shared_ptr<RangeMinIndex const> index_;
+    };
+}
+
+#endif
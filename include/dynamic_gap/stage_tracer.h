@@ -0,0 +1,112 @@
+#ifndef STAGE_TRACER_H
+#define STAGE_TRACER_H
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <stdint.h>
+#include <ros/ros.h>
+#include <diagnostic_msgs/DiagnosticArray.h>
+
+namespace dynamic_gap {
+    // Pipeline stages with their own latency histogram
+    enum TraceStage {
+        TRACE_HYBRID_SCAN_GAP = 0,
+        TRACE_MERGE_GAPS,
+        TRACE_DIST_MATRIX,
+        TRACE_ASSOCIATE_GAPS,
+        TRACE_UPDATE_MODELS,
+        TRACE_FEASIBILITY,
+        TRACE_GAP_MANIPULATE,
+        TRACE_GENERATE_TRAJECTORY,
+        TRACE_SCORE_TRAJECTORY,
+        TRACE_COMPARE_TO_OLD_TRAJ,
+        TRACE_CTRL_GENERATION,
+        NUM_TRACE_STAGES
+    };
+
+    const char* traceStageName(TraceStage stage);
+
+    // Latency histogram with log-linear buckets: exact below 8 ns, then 8 buckets per power of two,
+    // so any percentile is within 12.5% of the true value. Recording is a handful of relaxed atomic
+    // adds, safe from any thread (scoring runs under OpenMP).
+    class LatencyHistogram {
+        public:
+            static const int SUB_BUCKETS = 8;
+            static const int NUM_BUCKETS = SUB_BUCKETS * 62; // covers all of uint64_t
+
+            LatencyHistogram();
+
+            void record(uint64_t ns);
+            void reset();
+
+            uint64_t count() const { return count_.load(std::memory_order_relaxed); }
+            uint64_t bucketCount(int b) const { return buckets_[b].load(std::memory_order_relaxed); }
+            double meanMs() const;
+            double maxMs() const;
+            // upper edge of the bucket holding the q-quantile, capped by the largest sample
+            double percentileMs(double q) const;
+
+            static int bucketOf(uint64_t ns);
+            static uint64_t bucketLowerNs(int b);
+
+        private:
+            std::atomic<uint64_t> buckets_[NUM_BUCKETS];
+            std::atomic<uint64_t> count_;
+            std::atomic<uint64_t> sum_ns_;
+            std::atomic<uint64_t> max_ns_;
+    };
+
+    // Process-wide per-stage latency histograms. Disabled by default; while disabled a
+    // ScopedStageTimer costs one relaxed load and a branch.
+    class StageTracer {
+        public:
+            static StageTracer& get();
+
+            static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+            // histograms are cleared when tracing is switched on
+            void setEnabled(bool enable);
+
+            void record(TraceStage stage, uint64_t ns) { histograms_[stage].record(ns); }
+            const LatencyHistogram& histogram(TraceStage stage) const { return histograms_[stage]; }
+            void reset();
+
+            // one status per stage with count / mean / p50 / p90 / p99 / max in milliseconds
+            diagnostic_msgs::DiagnosticArray toDiagnostics(ros::Time stamp) const;
+            // summary table followed by the non-empty buckets, as CSV. Stages that never ran are left out
+            bool dump(const std::string& path) const;
+
+        private:
+            StageTracer() {};
+
+            static std::atomic<bool> enabled_;
+            LatencyHistogram histograms_[NUM_TRACE_STAGES];
+    };
+
+    // Times the enclosing scope into the given stage
+    class ScopedStageTimer {
+        public:
+            explicit ScopedStageTimer(TraceStage stage) : stage_(stage), active_(StageTracer::enabled()) {
+                if (active_) {
+                    start_ = std::chrono::steady_clock::now();
+                }
+            }
+
+            ~ScopedStageTimer() {
+                if (active_) {
+                    std::chrono::steady_clock::duration elapsed = std::chrono::steady_clock::now() - start_;
+                    StageTracer::get().record(stage_, std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed).count());
+                }
+            }
+
+        private:
+            ScopedStageTimer(const ScopedStageTimer&);
+            ScopedStageTimer& operator=(const ScopedStageTimer&);
+
+            TraceStage stage_;
+            bool active_;
+            std::chrono::steady_clock::time_point start_;
+    };
+}
+
+#endif
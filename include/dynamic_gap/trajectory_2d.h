@@ -0,0 +1,60 @@
+#ifndef TRAJECTORY_2D_H
+#define TRAJECTORY_2D_H
+
+#include <vector>
+#include <string>
+#include <ros/time.h>
+#include <geometry_msgs/PoseArray.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <boost/shared_ptr.hpp>
+
+namespace dynamic_gap {
+    // Planar rigid transform, p' = R(yaw) p + (x, y)
+    struct SE2Transform {
+        double x, y, yaw;
+
+        SE2Transform() : x(0.0), y(0.0), yaw(0.0) {};
+        SE2Transform(double _x, double _y, double _yaw) : x(_x), y(_y), yaw(_yaw) {};
+
+        // planar part of a tf transform, z / roll / pitch are dropped
+        static SE2Transform fromTransform(const geometry_msgs::TransformStamped& tf);
+
+        // applies other first, then this
+        SE2Transform operator*(const SE2Transform& other) const;
+    };
+
+    // Trajectory as contiguous x / y / yaw / t arrays in the frame it was generated in, plus a single planar
+    // transform to the frame it is currently expressed in. Moving it to another frame only composes that
+    // transform (the arrays are shared between copies), the poses are transformed once, when the trajectory is
+    // materialized as a PoseArray for publishing, scoring or control. Materialized poses lie in the z = 0 plane.
+    class Trajectory2D {
+        public:
+            Trajectory2D() {};
+            // samples in the frame of pose_arr, time_arr is either empty or one time per pose
+            Trajectory2D(const geometry_msgs::PoseArray& pose_arr, const std::vector<double>& time_arr);
+
+            int size() const { return samples_ ? (int) samples_->x.size() : 0; }
+            bool empty() const { return size() == 0; }
+            const std::vector<double>& times() const;
+            const std::string& frameId() const { return frame_id_; }
+            const SE2Transform& transform() const { return transform_; }
+
+            // the same trajectory in another frame, target_from_current maps the current frame into it
+            Trajectory2D transformed(const SE2Transform& target_from_current, const std::string& frame_id) const;
+            Trajectory2D transformed(const geometry_msgs::TransformStamped& target_from_current) const;
+
+            geometry_msgs::PoseArray toPoseArray() const;
+
+        private:
+            struct Samples {
+                std::vector<double> x, y, yaw, t;
+            };
+
+            boost::shared_ptr<Samples const> samples_;
+            SE2Transform transform_;
+            std::string frame_id_;
+            ros::Time stamp_;
+    };
+}
+
+#endif
@@ -16,6 +16,7 @@
 #include <dynamic_gap/gap.h>
 #include "dynamic_gap/TrajPlan.h"
 #include <dynamic_gap/gap_trajectory_generator.h>
+#include <dynamic_gap/scan_view.h>
 #include <visualization_msgs/Marker.h>
 #include <tf2/LinearMath/Quaternion.h>
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
@@ -26,13 +27,13 @@ namespace dynamic_gap {
         public:
 
             TrajectoryController(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg);
-            geometry_msgs::Twist obstacleAvoidanceControlLaw(sensor_msgs::LaserScan);
+            geometry_msgs::Twist obstacleAvoidanceControlLaw(const sensor_msgs::LaserScan&);
             geometry_msgs::Twist controlLaw(geometry_msgs::Pose current, nav_msgs::Odometry desired,
-                                            sensor_msgs::LaserScan inflated_egocircle, geometry_msgs::PoseStamped rbt_in_cam_lc,
+                                            const sensor_msgs::LaserScan& inflated_egocircle, geometry_msgs::PoseStamped rbt_in_cam_lc,
                                             geometry_msgs::Twist current_rbt_vel, geometry_msgs::Twist rbt_accel,
                                             dynamic_gap::cart_model * curr_right_model, dynamic_gap::cart_model * curr_left_model,
                                             double curr_peak_velocity_x, double curr_peak_velocity_y);
-            void updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg);
+            void updateEgoCircle(const ScanView& scan_view);
             int targetPoseIdx(geometry_msgs::Pose curr_pose, dynamic_gap::TrajPlan ref_pose);
             dynamic_gap::TrajPlan trajGen(geometry_msgs::PoseArray);
             
@@ -50,7 +51,7 @@ namespace dynamic_gap {
 
             Eigen::Vector2d car2pol(Eigen::Vector2d a);
             Eigen::Vector2d pol2car(Eigen::Vector2d a);
-            void run_projection_operator(sensor_msgs::LaserScan inflated_egocircle,  geometry_msgs::PoseStamped rbt_in_cam_lc,
+            void run_projection_operator(const sensor_msgs::LaserScan& inflated_egocircle,  geometry_msgs::PoseStamped rbt_in_cam_lc,
                                          Eigen::Vector2d cmd_vel_fb, Eigen::Vector2d & Psi_der,
                                          double & Psi, float & cmd_vel_x_safe, float & cmd_vel_y_safe,
                                          float & min_dist_ang, float & min_dist);
@@ -68,7 +69,7 @@ namespace dynamic_gap {
 
             double thres;
             const DynamicGapConfig* cfg_;
-            boost::shared_ptr<sensor_msgs::LaserScan const> msg_;
+            ScanView scan_view_;
             boost::mutex egocircle_l;
             ros::Publisher projection_viz;
             ros::Time last_time;
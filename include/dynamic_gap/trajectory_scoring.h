@@ -5,6 +5,9 @@
 #include <math.h>
 #include <dynamic_gap/gap.h>
 #include <dynamic_gap/dynamicgap_config.h>
+#include <dynamic_gap/beam_table.h>
+#include <dynamic_gap/beam_intersection.h>
+#include <dynamic_gap/stage_tracer.h>
 #include <vector>
 #include <map>
 #include <visualization_msgs/MarkerArray.h>
@@ -23,12 +26,27 @@
 #include <tf2_geometry_msgs/tf2_geometry_msgs.h>
 
 namespace dynamic_gap{
+    // Carried between consecutive recoverDynamicEgocircleCheat calls so that a propagated scan
+    // can be reused: only beams that agents covered at the previous step get restored
+    struct DynamicEgocircleState {
+        // static_scan is taken by the caller under egocircle_mutex, the propagation never reads static_msg itself
+        explicit DynamicEgocircleState(const boost::shared_ptr<sensor_msgs::LaserScan const> & _static_scan)
+            : static_scan(_static_scan) {};
+
+        bool primed = false;
+        boost::shared_ptr<sensor_msgs::LaserScan const> static_scan; // static scan the propagation starts from
+        std::vector<float> base_ranges; // static ranges clamped to the egocircle max range
+        std::vector<int> dirty_beams; // beams overwritten by agents at the previous step
+    };
+
     class TrajectoryArbiter{
         public:
         TrajectoryArbiter(){};
         ~TrajectoryArbiter(){};
 
         TrajectoryArbiter(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg);
+        // without a node handle nothing is advertised, for running off of recorded data (dynamic_gap_bench)
+        explicit TrajectoryArbiter(const dynamic_gap::DynamicGapConfig& cfg);
         TrajectoryArbiter& operator=(TrajectoryArbiter other) {cfg_ = other.cfg_;};
         TrajectoryArbiter(const TrajectoryArbiter &t) {cfg_ = t.cfg_;};
         
@@ -43,18 +61,44 @@ namespace dynamic_gap{
         // Full Scoring
         // std::vector<double> scoreTrajectories(std::vector<geometry_msgs::PoseArray>);
         geometry_msgs::PoseStamped getLocalGoal() {return local_goal; }; // in robot frame
+        // sets sides and freezes raw models, must be called before scoring (not thread safe)
+        void freezeRawModels(std::vector<dynamic_gap::Gap>& current_raw_gaps);
         std::vector<double> scoreTrajectory(geometry_msgs::PoseArray traj, 
                                                            std::vector<double> time_arr, std::vector<dynamic_gap::Gap>& current_raw_gaps,
                                                            std::vector<std::vector<double>> _agent_odoms, 
                                                            std::vector<std::vector<double>> _agent_vels,
                                                            bool print,
                                                            bool vis);
+        // the two halves of scoreTrajectory: pose-wise costs against the (propagated) egocircle, then the
+        // terminal goal cost. Pose-wise costs only depend on each pose and its time, so the costs of a
+        // trajectory suffix are the matching slice of the full trajectory's costs
+        std::vector<double> scorePoses(const geometry_msgs::PoseArray& traj, 
+                                       const std::vector<double>& time_arr, std::vector<dynamic_gap::Gap>& current_raw_gaps,
+                                       std::vector<std::vector<double>> _agent_odoms, 
+                                       const std::vector<std::vector<double>>& _agent_vels,
+                                       bool print);
+        std::vector<double> applyTerminalCost(const geometry_msgs::PoseArray& traj, std::vector<double> cost_val);
         
         void recoverDynamicEgocircleCheat(double t_i, double t_iplus1, 
                                                         std::vector<std::vector<double>> & _agent_odoms, 
                                                         std::vector<std::vector<double>> _agent_vels,
                                                         sensor_msgs::LaserScan& dynamic_laser_scan,
                                                         bool print);
+        void recoverDynamicEgocircleCheat(double t_i, double t_iplus1, 
+                                                        std::vector<std::vector<double>> & _agent_odoms, 
+                                                        const std::vector<std::vector<double>> & _agent_vels,
+                                                        sensor_msgs::LaserScan& dynamic_laser_scan,
+                                                        DynamicEgocircleState& state,
+                                                        bool print);
+        // Propagated egocircles on the integrate_stept grid, built once per planning cycle (on the planning thread)
+        // and then read concurrently by every scoreTrajectory call and by GapManipulator
+        void buildDynamicEgocircleCache(const std::vector<std::vector<double>> & _agent_odoms, 
+                                        const std::vector<std::vector<double>> & _agent_vels);
+        bool hasDynamicEgocircleCache() {return !dynamic_egocircle_cache.empty(); };
+        const sensor_msgs::LaserScan& getCachedDynamicEgocircle(double t);
+        // smallest range of getCachedDynamicEgocircle(t), taken once when the cache is built
+        float getCachedDynamicEgocircleMin(double t);
+
         void recoverDynamicEgoCircle(double t_i, double t_iplus1, std::vector<dynamic_gap::cart_model *> raw_models, sensor_msgs::LaserScan& dynamic_laser_scan);
         void visualizePropagatedEgocircle(sensor_msgs::LaserScan dynamic_laser_scan);
 
@@ -68,8 +112,9 @@ namespace dynamic_gap{
             boost::mutex gap_mutex, gplan_mutex, egocircle_mutex;
 
             int sgn_star(float dy);
-            double scorePose(geometry_msgs::Pose pose);
-            int dynamicGetMinDistIndex(geometry_msgs::Pose pose, sensor_msgs::LaserScan dynamic_laser_scan, bool print);
+            double scorePose(geometry_msgs::Pose pose, const sensor_msgs::LaserScan& stored_scan);
+            int dynamicGetMinDistIndex(geometry_msgs::Pose pose, const sensor_msgs::LaserScan& dynamic_laser_scan, bool print);
+            int nearestEgocircleIndex(const geometry_msgs::Pose& pose, const sensor_msgs::LaserScan& scan, double& min_dist);
 
             double dynamicScorePose(geometry_msgs::Pose pose, double theta, double range);
             double chapterScore(double d);
@@ -82,6 +127,14 @@ namespace dynamic_gap{
 
             int search_idx = -1;
 
+            std::vector<sensor_msgs::LaserScan> dynamic_egocircle_cache; // entry k is the egocircle at k * cache_stept
+            std::vector<float> dynamic_egocircle_min; // smallest range of each cache entry
+            int cacheStep(double t);
+            double cache_stept = 0.0;
+            // inputs of the current cache
+            boost::shared_ptr<sensor_msgs::LaserScan const> cache_scan, cache_static_scan;
+            std::vector<std::vector<double>> cache_agent_odoms, cache_agent_vels;
+
             double r_inscr, rmax, cobs, w;
             ros::Publisher propagatedEgocirclePublisher;
     };
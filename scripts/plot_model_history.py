@@ -0,0 +1,34 @@
+#!/usr/bin/env python
+# Plots gap model histories written by cart_model (model_history_depth > 0, model_history_dir set).
+# usage: plot_model_history.py <model_history_dir> [<output_dir>]
+import os
+import sys
+import glob
+import numpy as np
+import matplotlib
+matplotlib.use('Agg')
+import matplotlib.pyplot as plt
+
+def plot_history(csv_path, out_dir):
+    data = np.genfromtxt(csv_path, delimiter=',', names=True)
+    if data.size == 0:
+        return
+    data = np.atleast_1d(data)
+    name = os.path.splitext(os.path.basename(csv_path))[0]
+    for key in ['r_x', 'r_y', 'v_x', 'v_y']:
+        plt.figure(figsize=(12, 7.8))
+        plt.scatter(data['t'], data[key + '_gt'], s=25.0, label=key + ' (GT)')
+        plt.scatter(data['t'], data[key], s=25.0, label=key)
+        plt.xlim(0, 10)
+        plt.legend()
+        plt.savefig(os.path.join(out_dir, name + '_' + key + '.png'))
+        plt.close()
+
+if __name__ == '__main__':
+    if len(sys.argv) < 2:
+        print('usage: plot_model_history.py <model_history_dir> [<output_dir>]')
+        sys.exit(1)
+    in_dir = sys.argv[1]
+    out_dir = sys.argv[2] if len(sys.argv) > 2 else in_dir
+    for csv_path in sorted(glob.glob(os.path.join(in_dir, '*.csv'))):
+        plot_history(csv_path, out_dir)
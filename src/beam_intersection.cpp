@@ -0,0 +1,106 @@
+#include <dynamic_gap/beam_intersection.h>
+#include <cmath>
+#include <algorithm>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace dynamic_gap {
+    // Along beam u = (cos, sin), the ray t * u meets the agent circle where
+    //     t^2 - 2 t (a . u) + |a|^2 - r^2 = 0,  i.e.  t = b -/+ sqrt(r^2 - p^2),  b = a . u,  p = a x u.
+    // (r^2 - p^2 rather than b^2 - |a|^2 + r^2 keeps float precision for grazing beams.)
+    // The beam is clipped by the root nearest the robot, as long as it lies in (0, base) and is
+    // shorter than what is already there.
+    static inline void intersectBeam(float agent_x, float agent_y, float r2,
+                                     float cos_i, float sin_i, float base_i, float& out_i) {
+        float b = agent_x * cos_i + agent_y * sin_i;
+        float p = agent_x * sin_i - agent_y * cos_i;
+        float disc = r2 - p * p;
+        float sq = std::sqrt(std::max(disc, 0.0f));
+        float t0 = b - sq;
+        float t1 = b + sq;
+        float t = std::abs(t0) < std::abs(t1) ? t0 : t1;
+        bool hit = disc > 0.0f && base_i > 0.0f && t > 0.0f && t < base_i && t < out_i;
+        out_i = hit ? t : out_i;
+    }
+
+    void intersectAgentWithBeams(float agent_x, float agent_y, float r,
+                                 const float* cos_b, const float* sin_b, const float* base, float* out,
+                                 int begin, int end) {
+        float r2 = r * r;
+        int i = begin;
+
+#if defined(__AVX512F__)
+        const __m512 vax = _mm512_set1_ps(agent_x);
+        const __m512 vay = _mm512_set1_ps(agent_y);
+        const __m512 vr2 = _mm512_set1_ps(r2);
+        const __m512 zero = _mm512_setzero_ps();
+        for (; i + 16 <= end; i += 16) {
+            __m512 vcos = _mm512_loadu_ps(cos_b + i);
+            __m512 vsin = _mm512_loadu_ps(sin_b + i);
+            __m512 vbase = _mm512_loadu_ps(base + i);
+            __m512 vout = _mm512_loadu_ps(out + i);
+
+            __m512 b = _mm512_add_ps(_mm512_mul_ps(vax, vcos), _mm512_mul_ps(vay, vsin));
+            __m512 p = _mm512_sub_ps(_mm512_mul_ps(vax, vsin), _mm512_mul_ps(vay, vcos));
+            __m512 disc = _mm512_sub_ps(vr2, _mm512_mul_ps(p, p));
+            __m512 sq = _mm512_sqrt_ps(_mm512_max_ps(disc, zero));
+            __m512 t0 = _mm512_sub_ps(b, sq);
+            __m512 t1 = _mm512_add_ps(b, sq);
+            __mmask16 near0 = _mm512_cmp_ps_mask(_mm512_abs_ps(t0), _mm512_abs_ps(t1), _CMP_LT_OQ);
+            __m512 t = _mm512_mask_blend_ps(near0, t1, t0);
+
+            __mmask16 hit = _mm512_cmp_ps_mask(disc, zero, _CMP_GT_OQ);
+            hit &= _mm512_cmp_ps_mask(vbase, zero, _CMP_GT_OQ);
+            hit &= _mm512_cmp_ps_mask(t, zero, _CMP_GT_OQ);
+            hit &= _mm512_cmp_ps_mask(t, vbase, _CMP_LT_OQ);
+            hit &= _mm512_cmp_ps_mask(t, vout, _CMP_LT_OQ);
+            _mm512_storeu_ps(out + i, _mm512_mask_blend_ps(hit, vout, t));
+        }
+#elif defined(__AVX2__)
+        const __m256 vax = _mm256_set1_ps(agent_x);
+        const __m256 vay = _mm256_set1_ps(agent_y);
+        const __m256 vr2 = _mm256_set1_ps(r2);
+        const __m256 zero = _mm256_setzero_ps();
+        const __m256 abs_mask = _mm256_castsi256_ps(_mm256_set1_epi32(0x7fffffff));
+        for (; i + 8 <= end; i += 8) {
+            __m256 vcos = _mm256_loadu_ps(cos_b + i);
+            __m256 vsin = _mm256_loadu_ps(sin_b + i);
+            __m256 vbase = _mm256_loadu_ps(base + i);
+            __m256 vout = _mm256_loadu_ps(out + i);
+
+            __m256 b = _mm256_add_ps(_mm256_mul_ps(vax, vcos), _mm256_mul_ps(vay, vsin));
+            __m256 p = _mm256_sub_ps(_mm256_mul_ps(vax, vsin), _mm256_mul_ps(vay, vcos));
+            __m256 disc = _mm256_sub_ps(vr2, _mm256_mul_ps(p, p));
+            __m256 sq = _mm256_sqrt_ps(_mm256_max_ps(disc, zero));
+            __m256 t0 = _mm256_sub_ps(b, sq);
+            __m256 t1 = _mm256_add_ps(b, sq);
+            __m256 near0 = _mm256_cmp_ps(_mm256_and_ps(t0, abs_mask), _mm256_and_ps(t1, abs_mask), _CMP_LT_OQ);
+            __m256 t = _mm256_blendv_ps(t1, t0, near0);
+
+            __m256 hit = _mm256_cmp_ps(disc, zero, _CMP_GT_OQ);
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(vbase, zero, _CMP_GT_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, zero, _CMP_GT_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, vbase, _CMP_LT_OQ));
+            hit = _mm256_and_ps(hit, _mm256_cmp_ps(t, vout, _CMP_LT_OQ));
+            _mm256_storeu_ps(out + i, _mm256_blendv_ps(vout, t, hit));
+        }
+#endif
+
+        // scalar fallback, and the tail of the vector loops
+        for (; i < end; i++) {
+            intersectBeam(agent_x, agent_y, r2, cos_b[i], sin_b[i], base[i], out[i]);
+        }
+    }
+
+    const char* beamIntersectionKernel() {
+#if defined(__AVX512F__)
+        return "avx512";
+#elif defined(__AVX2__)
+        return "avx2";
+#else
+        return "scalar";
+#endif
+    }
+}
@@ -0,0 +1,100 @@
+#include <dynamic_gap/beam_table.h>
+#include <boost/shared_ptr.hpp>
+#include <boost/thread/mutex.hpp>
+#include <cmath>
+#include <algorithm>
+
+namespace dynamic_gap {
+    BeamTable::BeamTable(double angle_min, double angle_increment, int num_beams) :
+        angle_min_(angle_min), angle_increment_(angle_increment), num_beams_(num_beams), angles_(num_beams)
+    {
+        for (int i = 0; i < num_beams_; i++) {
+            angles_[i] = angle_min_ + i * angle_increment_;
+        }
+        fillTrig();
+    }
+
+    BeamTable::BeamTable(int num_beams) :
+        angle_min_(-M_PI), num_beams_(num_beams), angles_(num_beams)
+    {
+        double half_scan = num_beams / 2;
+        angle_increment_ = M_PI / half_scan;
+        // same expression the gap code uses to go from index to bearing
+        for (int i = 0; i < num_beams_; i++) {
+            angles_[i] = (i - half_scan) / half_scan * M_PI;
+        }
+        fillTrig();
+    }
+
+    void BeamTable::fillTrig() {
+        cos_.resize(num_beams_);
+        sin_.resize(num_beams_);
+        cosf_.resize(num_beams_);
+        sinf_.resize(num_beams_);
+        for (int i = 0; i < num_beams_; i++) {
+            cos_[i] = std::cos(angles_[i]);
+            sin_[i] = std::sin(angles_[i]);
+            cosf_[i] = (float) cos_[i];
+            sinf_[i] = (float) sin_[i];
+        }
+    }
+
+    void BeamTable::toCartesian(const std::vector<float>& ranges, std::vector<float>& x, std::vector<float>& y) const {
+        int n = std::min((int) ranges.size(), num_beams_);
+        x.resize(n);
+        y.resize(n);
+        const float* r = ranges.data();
+        const double* c = cos_.data();
+        const double* s = sin_.data();
+        float* xp = x.data();
+        float* yp = y.data();
+        // straight-line loop over contiguous arrays so the compiler can vectorize it
+        for (int i = 0; i < n; i++) {
+            xp[i] = r[i] * c[i];
+            yp[i] = r[i] * s[i];
+        }
+    }
+
+    namespace {
+        boost::mutex table_mutex;
+        std::vector<boost::shared_ptr<const BeamTable>> scan_tables;
+        std::vector<boost::shared_ptr<const BeamTable>> egocircle_tables;
+    }
+
+    const BeamTable& BeamTable::get(double angle_min, double angle_increment, int num_beams) {
+        // scan geometry practically never changes, so check the last table this thread used first
+        thread_local const BeamTable* last = NULL;
+        if (last && last->matches(angle_min, angle_increment, num_beams)) {
+            return *last;
+        }
+
+        boost::mutex::scoped_lock lock(table_mutex);
+        for (auto & table : scan_tables) {
+            if (table->matches(angle_min, angle_increment, num_beams)) {
+                last = table.get();
+                return *last;
+            }
+        }
+        scan_tables.push_back(boost::shared_ptr<const BeamTable>(new BeamTable(angle_min, angle_increment, num_beams)));
+        last = scan_tables.back().get();
+        return *last;
+    }
+
+    const BeamTable& BeamTable::egocircle(int num_beams) {
+        thread_local const BeamTable* last = NULL;
+        if (last && last->size() == num_beams) {
+            return *last;
+        }
+
+        boost::mutex::scoped_lock lock(table_mutex);
+        for (auto & table : egocircle_tables) {
+            if (table->size() == num_beams) {
+                last = table.get();
+                return *last;
+            }
+        }
+        egocircle_tables.push_back(boost::shared_ptr<const BeamTable>(new BeamTable(num_beams)));
+        last = egocircle_tables.back().get();
+        return *last;
+    }
+}
@@ -12,17 +12,46 @@
 #include <dynamic_gap/cart_model.h>
 #include <Eigen/Core>
 #include <Eigen/Dense>
-#include <unsupported/Eigen/MatrixFunctions>
 #include <limits>
 #include <sstream>
-#include "/home/masselmeier/Desktop/Research/vcpkg/installed/x64-linux/include/matplotlibcpp.h"
-
-namespace plt = matplotlibcpp;
-
 using namespace Eigen;
 
 namespace dynamic_gap {
 
+    // C[j] = int_0^T s^j cos(k s) ds and S[j] = int_0^T s^j sin(k s) ds for j = 0, 1, 2.
+    // The closed forms cancel badly as k T -> 0, so small arguments use the power series instead.
+    static void trigMoments(double k, double T, double C[3], double S[3]) {
+        double kT = k * T;
+        if (std::abs(kT) < 1.0) {
+            double x2 = kT * kT;
+            double T_pow = 1.0;
+            for (int j = 0; j < 3; j++) {
+                T_pow *= T;
+                double c_term = 1.0; // (-1)^n x^(2n) / (2n)!
+                double s_term = kT;  // (-1)^n x^(2n+1) / (2n+1)!
+                double c_sum = 0.0, s_sum = 0.0;
+                for (int n = 0; n < 10; n++) {
+                    c_sum += c_term / (2*n + j + 1);
+                    s_sum += s_term / (2*n + j + 2);
+                    c_term *= -x2 / ((2*n + 1) * (2*n + 2));
+                    s_term *= -x2 / ((2*n + 2) * (2*n + 3));
+                }
+                C[j] = T_pow * c_sum;
+                S[j] = T_pow * s_sum;
+            }
+            return;
+        }
+
+        double c = std::cos(kT), s = std::sin(kT);
+        double k2 = k * k, k3 = k2 * k;
+        C[0] = s / k;
+        S[0] = (1.0 - c) / k;
+        C[1] = T * s / k + (c - 1.0) / k2;
+        S[1] = -T * c / k + s / k2;
+        C[2] = T * T * s / k + 2.0 * T * c / k2 - 2.0 * s / k3;
+        S[2] = -T * T * c / k + 2.0 * T * s / k2 + 2.0 * (c - 1.0) / k3;
+    }
+
     cart_model::cart_model(std::string _side, int _index, double init_r, double init_beta, Matrix<double, 1, 3> v_ego) {
         side = _side;
         index = _index;
@@ -91,15 +120,6 @@ namespace dynamic_gap {
         new_P = eyes;
         inverted_tmp_mat << 0.0, 0.0, 0.0, 0.0;
         x_update << 0.0, 0.0, 0.0, 0.0;
-        std::vector<double> state{life_time, x[0], x[1], x[2], x[3]};
-        std::vector<double> ego_accels{a_ego[0], a_ego[1], a_ego[2]};
-        std::vector<double> ego_vels{v_ego[0], v_ego[1], v_ego[2]};
-        std::vector<double> measurement{x_tilde[0], x_tilde[1], -v_ego[0], -v_ego[1]};
-        previous_states.push_back(state);
-        previous_measurements.push_back(measurement);
-        previous_ego_accels.push_back(ego_accels);
-        previous_ego_vels.push_back(ego_vels);
-        plot_dir = "/home/masselmeier/catkin_ws/src/DynamicGap/estimator_plots/";
         perfect = true;
 
         // alpha_R = 0.3;
@@ -172,7 +192,14 @@ namespace dynamic_gap {
                 0.0, 0.0, 0.0, ang_vel_ego,
                 0.0, 0.0, -ang_vel_ego, 0.0;
 
-        STM = (A*dt).exp(); // eyes + A * dt;
+        // A = [W I; 0 W] with W = [0 w; -w 0]. W commutes with I, so the exponential is closed form:
+        // exp(A dt) = [R dt*R; 0 R], R = exp(W dt) = [cos(w dt) sin(w dt); -sin(w dt) cos(w dt)]
+        double c = std::cos(ang_vel_ego * dt);
+        double s = std::sin(ang_vel_ego * dt);
+        STM << c, s, c*dt, s*dt,
+               -s, c, -s*dt, c*dt,
+               0.0, 0.0, c, s,
+               0.0, 0.0, -s, c;
 
         if (print) {
             ROS_INFO_STREAM("linearizing");
@@ -208,37 +235,51 @@ namespace dynamic_gap {
             ROS_INFO_STREAM("   " << Q(2, 0) << ", " << Q(2, 1) << ", " << Q(2, 2) << ", " << Q(2, 3));
             ROS_INFO_STREAM("   " << Q(3, 0) << ", " << Q(3, 1) << ", " << Q(3, 2) << ", " << Q(3, 3));
         }
-        Q_1 = Q;
-        Q_2 = A * Q_1 + Q_1 * A.transpose();
-        Q_3 = A * Q_2 + Q_2 * A.transpose();
+        // dQ = int_0^dt exp(A s) Q exp(A s)^T ds, exactly. Noise only enters the velocities, so with
+        // R(s) from linearize()
+        //     exp(A s) Q exp(A s)^T = [s^2 M(s)  s M(s); s M(s)  M(s)],  M(s) = R(s) diag(q_x, q_y) R(s)^T
+        //                                                                    = m I + d [cos 2ws  -sin 2ws; -sin 2ws  -cos 2ws]
+        // with m = (q_x + q_y) / 2, d = (q_x - q_y) / 2, and each block integrates against s^j cos/sin(2ws).
+        double m = (Q(2, 2) + Q(3, 3)) / 2.0;
+        double d = (Q(2, 2) - Q(3, 3)) / 2.0;
+        double C[3], S[3];
+        trigMoments(2.0 * ang_vel_ego, dt, C, S);
+
+        Matrix2d blocks[3];
+        double dt_pow = 1.0;
+        for (int j = 0; j < 3; j++) {
+            dt_pow *= dt;
+            double P_j = dt_pow / (j + 1);
+            blocks[j] << m * P_j + d * C[j], -d * S[j],
+                         -d * S[j], m * P_j - d * C[j];
+        }
 
-        dQ = (Q_1 * dt) + (Q_2 * dt * dt / 2.0) + (Q_3 * dt * dt * dt / 6.0);
+        dQ.block<2, 2>(0, 0) = blocks[2];
+        dQ.block<2, 2>(0, 2) = blocks[1];
+        dQ.block<2, 2>(2, 0) = blocks[1];
+        dQ.block<2, 2>(2, 2) = blocks[0];
     }
 
-    void cart_model::kf_update_loop(Matrix<double, 2, 1> range_bearing_measurement, 
-                                    Matrix<double, 1, 3> _a_ego, Matrix<double, 1, 3> _v_ego, 
-                                    bool _print,
-                                    std::vector< std::vector<double>> _agent_odoms,
-                                    std::vector< std::vector<double>> _agent_vels) {
-        agent_odoms = _agent_odoms;
-        agent_vels = _agent_vels;
+    void cart_model::begin_update(const Matrix<double, 2, 1> & range_bearing_measurement, 
+                                  const Matrix<double, 1, 3> & _a_ego, const Matrix<double, 1, 3> & _v_ego, 
+                                  bool _print,
+                                  const std::vector< std::vector<double>> & _agent_odoms,
+                                  const std::vector< std::vector<double>> & _agent_vels,
+                                  double _t) {
         print = _print;
                 
-        t = ros::Time::now().toSec();
+        t = _t;
         dt = t - t_min1;
         life_time += dt;
         //std::cout << "model lifetime: " << life_time << std::endl;
         // acceleration comes in wrt robot frame
         a_ego = _a_ego;
         v_ego = _v_ego;
-        //  Eigen::Vector4d cart_state = get_cartesian_state();
-        //std::cout << "acceleration" << std::endl;
-        //std::cout<< "integrating" << std::endl;
 
         x_tilde << range_bearing_measurement[0]*std::cos(range_bearing_measurement[1]),
                         range_bearing_measurement[0]*std::sin(range_bearing_measurement[1]);
         
-        x_ground_truth = update_ground_truth_cartesian_state();
+        x_ground_truth = update_ground_truth_cartesian_state(_agent_odoms, _agent_vels);
 
         if (print) {
             ROS_INFO_STREAM("update for model " << get_index());
@@ -247,6 +288,26 @@ namespace dynamic_gap {
             ROS_INFO_STREAM("linear ego vel: " << v_ego[0] << ", " << v_ego[1] << ", angular ego vel: " << v_ego[2]);
             ROS_INFO_STREAM("linear ego acceleration: " << a_ego[0] << ", " << a_ego[1] << ", angular ego acc: " << a_ego[2]);
         }
+    }
+
+    void cart_model::end_update() {
+        t_min1 = t;
+
+        if (history.enabled() && !history_dumped) {
+            if (life_time <= life_time_threshold) {
+                history.push(life_time, x, x_ground_truth, v_ego, a_ego);
+            } else {
+                dump_history();
+            }
+        }
+    }
+
+    void cart_model::kf_update_loop(const Matrix<double, 2, 1> & range_bearing_measurement, 
+                                    const Matrix<double, 1, 3> & _a_ego, const Matrix<double, 1, 3> & _v_ego, 
+                                    bool _print,
+                                    const std::vector< std::vector<double>> & _agent_odoms,
+                                    const std::vector< std::vector<double>> & _agent_vels) {
+        begin_update(range_bearing_measurement, _a_ego, _v_ego, _print, _agent_odoms, _agent_vels, ros::Time::now().toSec());
 
         // 1. STATE PROPAGATE
         integrate();
@@ -313,87 +374,35 @@ namespace dynamic_gap {
             ROS_INFO_STREAM("-----------");
         }
         // std::cout << "P after update: " << P << std::endl;
-        t_min1 = t;
-
-        if (life_time <= life_time_threshold && !plotted) {
-            std::vector<double> state{life_time, x[0], x[1], x[2], x[3]};
-            std::vector<double> ground_truths{x_ground_truth[0], x_ground_truth[1], x_ground_truth[2], x_ground_truth[3]};
-                            
-            std::vector<double> ego_vels{v_ego[0], v_ego[1], v_ego[2]};
-            std::vector<double> ego_accels{a_ego[0], a_ego[1], a_ego[2]};
-        
-            previous_states.push_back(state);
-            previous_measurements.push_back(ground_truths);
-            previous_ego_accels.push_back(ego_accels);
-            previous_ego_vels.push_back(ego_vels);            
-        }
+        end_update();
+    }
 
-        if (life_time > life_time_threshold && !plotted) {
-            plot_states();
-        }
+    void cart_model::enable_history(int depth, const std::string& dir) {
+        history.setDepth(depth);
+        history_dir = dir;
+        history_dumped = false;
 
+        // first record is the initializing measurement
+        Eigen::Vector4d measurement(x_tilde[0], x_tilde[1], -v_ego[0], -v_ego[1]);
+        history.push(life_time, x, measurement, v_ego, a_ego);
     }
 
-    void cart_model::plot_states() {;
-        int n = previous_states.size();
-        std::vector<double> t(n), r_xs(n), r_ys(n), v_xs(n), v_ys(n), 
-                            r_xs_GT(n), r_ys_GT(n), v_xs_GT(n), v_ys_GT(n),
-                            v_ego_angs(n), a_ego_angs(n), a_xs(n), a_ys(n);
-        for(int i=0; i < previous_states.size(); i++) {
-            t.at(i) = previous_states[i][0];
-            r_xs.at(i) = previous_states[i][1];
-            r_ys.at(i) = previous_states[i][2];
-            v_xs.at(i) = previous_states[i][3];
-            v_ys.at(i) = previous_states[i][4];
-            r_xs_GT.at(i) = previous_measurements[i][0];
-            r_ys_GT.at(i) = previous_measurements[i][1];
-            v_xs_GT.at(i) = previous_measurements[i][2];
-            v_ys_GT.at(i) = previous_measurements[i][3];
-            v_ego_angs.at(i) = previous_ego_vels[i][2];
-            a_ego_angs.at(i) = previous_ego_accels[i][2];
-            a_xs.at(i) = previous_ego_accels[i][0];
+    void cart_model::dump_history() {
+        if (!history_dir.empty()) {
+            std::string path = history_dir + "/" + std::to_string(index) + "_" + side + ".csv";
+            if (!history.dump(path)) {
+                ROS_WARN_STREAM("could not write model history to " << path);
+            }
         }
+        history_dumped = true;
+    }
 
-        plt::figure_size(1200, 780);
-        plt::scatter(t, r_xs_GT, 25.0, {{"label", "r_x (GT)"}});
-        plt::scatter(t, r_xs, 25.0, {{"label", "r_x"}});
-        plt::xlim(0, 10);
-        plt::legend();
-        plt::save(plot_dir + std::to_string(index) + "_r_x.png");
-        plt::close();
-
-        plt::figure_size(1200, 780);
-        plt::scatter(t, r_ys_GT, 25.0, {{"label", "r_y (GT)"}});
-        plt::scatter(t, r_ys, 25.0, {{"label", "r_y"}});
-        plt::xlim(0, 10);
-        plt::legend();
-        plt::save(plot_dir + std::to_string(index) + "_r_y.png");
-        plt::close();
-
-        plt::figure_size(1200, 780);
-        // plt::scatter(t, a_xs, 25.0, {{"label", "a_x"}});
-        // plt::scatter(t, v_ego_angs, 25.0, {{"label", "v_ego"}});
-        plt::scatter(t, v_xs_GT, 25.0, {{"label", "v_x (GT)"}});
-        plt::scatter(t, v_xs, 25.0, {{"label", "v_x"}});
-        plt::xlim(0, 10);
-        plt::legend();
-        plt::save(plot_dir + std::to_string(index) + "_v_x.png");
-        plt::close();
-
-        plt::figure_size(1200, 780);
-        // plt::scatter(t, a_xs, 25.0, {{"label", "a_x"}});
-        // plt::scatter(t, v_ego_angs, 25.0, {{"label", "v_ego"}});
-        plt::scatter(t, v_ys_GT, 25.0, {{"label", "v_y (GT)"}});
-        plt::scatter(t, v_ys, 25.0, {{"label", "v_y"}});
-        plt::xlim(0, 10);
-        plt::legend();
-        plt::save(plot_dir + std::to_string(index) + "_v_y.png");
-        plt::close();
-
-        plotted = true;
+    const ModelHistory& cart_model::get_history() {
+        return history;
     }
 
-    Eigen::Vector4d cart_model::update_ground_truth_cartesian_state() {
+    Eigen::Vector4d cart_model::update_ground_truth_cartesian_state(const std::vector< std::vector<double>> & agent_odoms,
+                                                                    const std::vector< std::vector<double>> & agent_vels) {
         // x state:
         // [r_x, r_y, v_x, v_y]
         Eigen::Vector4d return_x = x_ground_truth;
@@ -0,0 +1,465 @@
+// Headless benchmark of the planner core. Replays a bag recorded from a running planner (egocircle, robot
+// odometry/acceleration and agent odometry) through the perception and planning steps laserScanCB and
+// getPlanTrajectory run (planning_steps.h), and reports per-stage latency from the StageTracer histograms.
+// Nothing is advertised or subscribed, so no roscore is needed.
+//
+// compareToOldTraj and ctrlGeneration are not driven: they work off of the executing trajectory and the
+// controller's live odometry, which a replay does not have. Their stages are left out of the report.
+//
+// usage: dynamic_gap_bench <bag> [options]
+//   --agents N           number of agents, read from /robot0/odom ... /robot{N-1}/odom (rbt.num_obsts, 0)
+//   --scan TOPIC         egocircle (/point_scan)
+//   --static-scan TOPIC  static egocircle (/robot{N}/laser_0), the egocircle is used when it is not recorded
+//   --odom TOPIC         robot odometry (/odom)
+//   --acc TOPIC          robot acceleration (<robot_frame_id>/acc)
+//   --goal X Y           goal in the odom frame, otherwise the local goal is held 3 m ahead of the robot
+//   --plan-every K       run the planning stages on every K-th scan (1)
+//   --repeat R           replay the bag R times (1)
+//   --dump FILE          write the stage histograms as CSV (same layout as tracing.dump_file)
+//   --baseline FILE      CSV from an earlier --dump, exit with 1 if any stage's p99 is more than
+//   --tolerance F        F (0.25) above its baseline
+//   --verbose            keep the planner's INFO logging
+//
+// Agents are expected in the same world frame as the robot odometry. Trajectories are generated one after
+// another (planning.parallel_traj_gen is ignored) so generateTrajectory / scoreTrajectory are per call.
+// The local goal comes from --goal rather than the goal selector.
+
+#include <ros/ros.h>
+#include <ros/console.h>
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+#include <sensor_msgs/LaserScan.h>
+#include <nav_msgs/Odometry.h>
+#include <geometry_msgs/Twist.h>
+#include <geometry_msgs/PoseStamped.h>
+#include <geometry_msgs/TransformStamped.h>
+#include <boost/foreach.hpp>
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <dynamic_gap/dynamicgap_config.h>
+#include <dynamic_gap/scan_view.h>
+#include <dynamic_gap/gap_utils.h>
+#include <dynamic_gap/gap_associator.h>
+#include <dynamic_gap/dist_matrix.h>
+#include <dynamic_gap/kalman_batch.h>
+#include <dynamic_gap/planning_steps.h>
+#include <dynamic_gap/gap_feasibility.h>
+#include <dynamic_gap/gap_manip.h>
+#include <dynamic_gap/gap_trajectory_generator.h>
+#include <dynamic_gap/trajectory_scoring.h>
+#include <dynamic_gap/trajectory_2d.h>
+#include <dynamic_gap/stage_tracer.h>
+
+namespace dynamic_gap {
+    struct BenchOptions {
+        std::string bag;
+        int agents = 0;
+        std::string scan_topic = "/point_scan";
+        std::string static_scan_topic;
+        std::string odom_topic = "/odom";
+        std::string acc_topic;
+        bool has_goal = false;
+        double goal_x = 0, goal_y = 0;
+        int plan_every = 1;
+        int repeat = 1;
+        std::string dump_file;
+        std::string baseline_file;
+        double tolerance = 0.25;
+        bool verbose = false;
+    };
+
+    // planar pose of the robot in the odom frame
+    struct PlanarPose {
+        double x = 0, y = 0, yaw = 0;
+    };
+
+    static double yawOf(const geometry_msgs::Quaternion& q) {
+        return std::atan2(2.0 * (q.w * q.z + q.x * q.y), 1.0 - 2.0 * (q.y * q.y + q.z * q.z));
+    }
+
+    static geometry_msgs::TransformStamped planarTransform(double x, double y, double yaw) {
+        geometry_msgs::TransformStamped tf;
+        tf.transform.translation.x = x;
+        tf.transform.translation.y = y;
+        tf.transform.rotation.z = std::sin(yaw / 2.0);
+        tf.transform.rotation.w = std::cos(yaw / 2.0);
+        return tf;
+    }
+
+    static std::string withSlash(const std::string& topic) {
+        return (topic.empty() || topic[0] == '/') ? topic : "/" + topic;
+    }
+
+    class PlannerBench {
+        public:
+            explicit PlannerBench(const DynamicGapConfig& cfg) :
+                cfg_(cfg), finder(cfg), associator(cfg), feasibility(cfg), manip(cfg), traj_gen(cfg), arbiter(cfg) {
+                agent_odom_vects.resize(cfg.rbt.num_obsts, std::vector<double>(2));
+                agent_vel_vects.resize(cfg.rbt.num_obsts, std::vector<double>(2));
+                rbt_in_cam.header.frame_id = cfg.robot_frame_id;
+                rbt_in_cam.pose.orientation.w = 1;
+                reset();
+            }
+
+            void reset() {
+                model_idx = 0;
+                raw_gaps.clear();
+                observed_gaps.clear();
+                associated_raw_gaps.clear();
+                associated_observed_gaps.clear();
+                static_scan.reset();
+                rbt_pose = PlanarPose();
+                rbt_vel = geometry_msgs::Twist();
+                rbt_accel = geometry_msgs::Twist();
+                for (int i = 0; i < cfg_.rbt.num_obsts; i++) {
+                    agent_odom_vects[i] = std::vector<double>(2, 0.0);
+                    agent_vel_vects[i] = std::vector<double>(2, 0.0);
+                }
+            }
+
+            void odomCB(const nav_msgs::Odometry& msg) {
+                rbt_pose.x = msg.pose.pose.position.x;
+                rbt_pose.y = msg.pose.pose.position.y;
+                rbt_pose.yaw = yawOf(msg.pose.pose.orientation);
+                rbt_vel = msg.twist.twist;
+            }
+
+            void accCB(const geometry_msgs::Twist& msg) {
+                rbt_accel = msg;
+            }
+
+            void staticScanCB(boost::shared_ptr<sensor_msgs::LaserScan const> msg) {
+                static_scan = msg;
+            }
+
+            // agent pose and velocity in the robot frame, as in Planner::agentOdomCB
+            void agentOdomCB(int agent, const nav_msgs::Odometry& msg) {
+                double c = std::cos(rbt_pose.yaw), s = std::sin(rbt_pose.yaw);
+                double dx = msg.pose.pose.position.x - rbt_pose.x;
+                double dy = msg.pose.pose.position.y - rbt_pose.y;
+                agent_odom_vects[agent][0] = c * dx + s * dy;
+                agent_odom_vects[agent][1] = -s * dx + c * dy;
+
+                double rel_yaw = yawOf(msg.pose.pose.orientation) - rbt_pose.yaw;
+                double vx = msg.twist.twist.linear.x, vy = msg.twist.twist.linear.y;
+                agent_vel_vects[agent][0] = std::cos(rel_yaw) * vx - std::sin(rel_yaw) * vy;
+                agent_vel_vects[agent][1] = std::sin(rel_yaw) * vx + std::cos(rel_yaw) * vy;
+            }
+
+            // gap detection, association and model updates, as in Planner::laserScanCB
+            void perceive(boost::shared_ptr<sensor_msgs::LaserScan const> msg, const BenchOptions& opts) {
+                scan_view = ScanView(msg, scan_index_pool);
+                double c = std::cos(rbt_pose.yaw), s = std::sin(rbt_pose.yaw);
+                odom2rbt = planarTransform(-(c * rbt_pose.x + s * rbt_pose.y), -(-s * rbt_pose.x + c * rbt_pose.y), -rbt_pose.yaw);
+                rbt2odom = planarTransform(rbt_pose.x, rbt_pose.y, rbt_pose.yaw);
+
+                local_goal_rbt = geometry_msgs::PoseStamped();
+                local_goal_rbt.header.frame_id = cfg_.robot_frame_id;
+                local_goal_rbt.pose.orientation.w = 1;
+                if (opts.has_goal) {
+                    double dx = opts.goal_x - rbt_pose.x, dy = opts.goal_y - rbt_pose.y;
+                    local_goal_rbt.pose.position.x = c * dx + s * dy;
+                    local_goal_rbt.pose.position.y = -s * dx + c * dy;
+                } else {
+                    local_goal_rbt.pose.position.x = 3.0;
+                }
+                final_goal_rbt = opts.has_goal ? local_goal_rbt : geometry_msgs::PoseStamped();
+
+                Matrix<double, 1, 3> v_ego(rbt_vel.linear.x, rbt_vel.linear.y, rbt_vel.angular.z);
+                Matrix<double, 1, 3> a_ego(rbt_accel.linear.x, rbt_accel.linear.y, rbt_accel.angular.z);
+                // recorded time rather than now, so the filters see the recorded scan intervals
+                double t = msg->header.stamp.toSec();
+
+                previous_raw_gaps = associated_raw_gaps;
+                previous_gaps = associated_observed_gaps;
+                finder.findGaps(scan_view, final_goal_rbt, raw_gaps, observed_gaps);
+
+                associateGapSet(associator, raw_gaps, previous_raw_gaps, "raw", raw_distMatrix, raw_association, v_ego, &model_idx);
+                associated_raw_gaps = raw_gaps;
+                updateGapModels(associated_raw_gaps, rbt_in_cam, kf_batch, a_ego, v_ego, agent_odom_vects, agent_vel_vects, t);
+
+                associateGapSet(associator, observed_gaps, previous_gaps, "simplified", simp_distMatrix, simp_association, v_ego, &model_idx);
+                associated_observed_gaps = observed_gaps;
+                updateGapModels(associated_observed_gaps, rbt_in_cam, kf_batch, a_ego, v_ego, agent_odom_vects, agent_vel_vects, t);
+            }
+
+            // feasibility, manipulation, trajectory generation and scoring, as in Planner::getPlanTrajectory
+            int plan() {
+                boost::shared_ptr<sensor_msgs::LaserScan const> static_msg = static_scan ? static_scan : scan_view.ptr();
+                updatePlanningEgoCircle(scan_view, arbiter, manip, feasibility);
+                arbiter.updateStaticEgoCircle(static_msg);
+                arbiter.updateLocalGoal(localGoalOdom(), odom2rbt);
+                manip.updateStaticEgoCircle(static_msg);
+
+                std::vector<dynamic_gap::Gap> manip_set = feasibleGaps(feasibility, associated_observed_gaps);
+                manipulateGaps(manip, arbiter, manip_set, local_goal_rbt, agent_odom_vects, agent_vel_vects);
+
+                std::vector<std::tuple<geometry_msgs::PoseArray, std::vector<double>>> trajs;
+                std::vector<std::vector<double>> scores;
+                generateGapTrajectories(traj_gen, arbiter, manip_set, rbt_in_cam, rbt_vel, associated_raw_gaps,
+                                        agent_odom_vects, agent_vel_vects, false, trajs, scores);
+                for (size_t i = 0; i < trajs.size(); i++) {
+                    // what initialTrajGen publishes for every gap
+                    dynamic_gap::Trajectory2D(std::get<0>(trajs.at(i)), std::get<1>(trajs.at(i))).transformed(rbt2odom).toPoseArray();
+                }
+                return (int) trajs.size();
+            }
+
+            int numGaps() const { return (int) associated_observed_gaps.size(); }
+
+        private:
+            geometry_msgs::PoseStamped localGoalOdom() {
+                double c = std::cos(rbt_pose.yaw), s = std::sin(rbt_pose.yaw);
+                geometry_msgs::PoseStamped goal = local_goal_rbt;
+                goal.header.frame_id = cfg_.odom_frame_id;
+                goal.pose.position.x = rbt_pose.x + c * local_goal_rbt.pose.position.x - s * local_goal_rbt.pose.position.y;
+                goal.pose.position.y = rbt_pose.y + s * local_goal_rbt.pose.position.x + c * local_goal_rbt.pose.position.y;
+                return goal;
+            }
+
+            const DynamicGapConfig& cfg_;
+            GapUtils finder;
+            GapAssociator associator;
+            GapFeasibilityChecker feasibility;
+            GapManipulator manip;
+            GapTrajGenerator traj_gen;
+            TrajectoryArbiter arbiter;
+            KalmanBatch kf_batch;
+
+            ScanView scan_view;
+            RangeMinIndexPool scan_index_pool;
+            boost::shared_ptr<sensor_msgs::LaserScan const> static_scan;
+            std::vector<dynamic_gap::Gap> raw_gaps, observed_gaps;
+            std::vector<dynamic_gap::Gap> previous_raw_gaps, previous_gaps;
+            std::vector<dynamic_gap::Gap> associated_raw_gaps, associated_observed_gaps;
+            std::vector<int> raw_association, simp_association;
+            DistMatrix raw_distMatrix, simp_distMatrix;
+            int model_idx;
+
+            PlanarPose rbt_pose;
+            geometry_msgs::Twist rbt_vel, rbt_accel;
+            geometry_msgs::PoseStamped rbt_in_cam, local_goal_rbt, final_goal_rbt;
+            geometry_msgs::TransformStamped odom2rbt, rbt2odom;
+            std::vector<std::vector<double>> agent_odom_vects, agent_vel_vects;
+    };
+
+    // stages the replay drives, compareToOldTraj and ctrlGeneration are not among them
+    static bool benchStage(TraceStage stage) {
+        return stage != TRACE_COMPARE_TO_OLD_TRAJ && stage != TRACE_CTRL_GENERATION;
+    }
+
+    static uint64_t elapsedNs(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    static void printRow(const std::string& name, const LatencyHistogram& hist) {
+        double mean = hist.meanMs();
+        printf("%-20s %8llu %10.4f %10.4f %10.4f %10.4f %10.4f %12.1f\n", name.c_str(), (unsigned long long) hist.count(),
+               mean, hist.percentileMs(0.5), hist.percentileMs(0.9), hist.percentileMs(0.99), hist.maxMs(),
+               mean > 0 ? 1000.0 / mean : 0.0);
+    }
+
+    // p99 of each stage from the summary table of a StageTracer::dump
+    static bool readBaseline(const std::string& path, std::map<std::string, double>& p99) {
+        std::ifstream in(path.c_str());
+        if (!in) {
+            return false;
+        }
+        std::string line;
+        std::getline(in, line); // header
+        while (std::getline(in, line) && !line.empty()) {
+            std::stringstream ss(line);
+            std::string field;
+            std::vector<std::string> fields;
+            while (std::getline(ss, field, ',')) {
+                fields.push_back(field);
+            }
+            if (fields.size() >= 6 && std::atof(fields[1].c_str()) > 0) {
+                p99[fields[0]] = std::atof(fields[5].c_str());
+            }
+        }
+        return true;
+    }
+
+    static int parseArgs(int argc, char** argv, BenchOptions& opts) {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            bool has_value = i + 1 < argc;
+            if (arg == "--agents" && has_value) {
+                opts.agents = std::atoi(argv[++i]);
+            } else if (arg == "--scan" && has_value) {
+                opts.scan_topic = argv[++i];
+            } else if (arg == "--static-scan" && has_value) {
+                opts.static_scan_topic = argv[++i];
+            } else if (arg == "--odom" && has_value) {
+                opts.odom_topic = argv[++i];
+            } else if (arg == "--acc" && has_value) {
+                opts.acc_topic = argv[++i];
+            } else if (arg == "--goal" && i + 2 < argc) {
+                opts.has_goal = true;
+                opts.goal_x = std::atof(argv[++i]);
+                opts.goal_y = std::atof(argv[++i]);
+            } else if (arg == "--plan-every" && has_value) {
+                opts.plan_every = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--repeat" && has_value) {
+                opts.repeat = std::max(1, std::atoi(argv[++i]));
+            } else if (arg == "--dump" && has_value) {
+                opts.dump_file = argv[++i];
+            } else if (arg == "--baseline" && has_value) {
+                opts.baseline_file = argv[++i];
+            } else if (arg == "--tolerance" && has_value) {
+                opts.tolerance = std::atof(argv[++i]);
+            } else if (arg == "--verbose") {
+                opts.verbose = true;
+            } else if (opts.bag.empty() && arg[0] != '-') {
+                opts.bag = arg;
+            } else {
+                fprintf(stderr, "dynamic_gap_bench: unknown argument %s\n", arg.c_str());
+                return -1;
+            }
+        }
+        return opts.bag.empty() ? -1 : 0;
+    }
+}
+
+int main(int argc, char** argv) {
+    using namespace dynamic_gap;
+
+    BenchOptions opts;
+    if (parseArgs(argc, argv, opts) != 0) {
+        fprintf(stderr, "usage: dynamic_gap_bench <bag> [--agents N] [--scan TOPIC] [--static-scan TOPIC] [--odom TOPIC] "
+                        "[--acc TOPIC] [--goal X Y] [--plan-every K] [--repeat R] [--dump FILE] [--baseline FILE] "
+                        "[--tolerance F] [--verbose]\n");
+        return 2;
+    }
+
+    // wall clock time without a master
+    ros::Time::init();
+    if (!opts.verbose && ros::console::set_logger_level(ROSCONSOLE_DEFAULT_NAME, ros::console::levels::Warn)) {
+        ros::console::notifyLoggerLevelsChanged();
+    }
+
+    DynamicGapConfig cfg;
+    cfg.rbt.num_obsts = opts.agents;
+    std::string scan_topic = withSlash(opts.scan_topic);
+    std::string static_scan_topic = withSlash(opts.static_scan_topic.empty() ? "/robot" + std::to_string(opts.agents) + "/laser_0" : opts.static_scan_topic);
+    std::string odom_topic = withSlash(opts.odom_topic);
+    std::string acc_topic = withSlash(opts.acc_topic.empty() ? cfg.robot_frame_id + "/acc" : opts.acc_topic);
+    std::map<std::string, int> agent_topics;
+    for (int i = 0; i < opts.agents; i++) {
+        agent_topics["/robot" + std::to_string(i) + "/odom"] = i;
+    }
+
+    rosbag::Bag bag;
+    try {
+        bag.open(opts.bag, rosbag::bagmode::Read);
+    } catch (rosbag::BagException& e) {
+        fprintf(stderr, "dynamic_gap_bench: could not open %s: %s\n", opts.bag.c_str(), e.what());
+        return 2;
+    }
+
+    std::vector<std::string> topics = {scan_topic, static_scan_topic, odom_topic, acc_topic};
+    for (const std::pair<const std::string, int>& agent : agent_topics) {
+        topics.push_back(agent.first);
+    }
+
+    StageTracer::get().setEnabled(true);
+    LatencyHistogram perception_cycle, planning_cycle;
+    long num_scans = 0, num_plans = 0, num_trajectories = 0, num_gaps = 0;
+
+    PlannerBench bench(cfg);
+    for (int r = 0; r < opts.repeat; r++) {
+        bench.reset();
+        rosbag::View view(bag, rosbag::TopicQuery(topics));
+        int scan_count = 0;
+        BOOST_FOREACH(rosbag::MessageInstance const m, view) {
+            std::string topic = withSlash(m.getTopic());
+            if (topic == scan_topic) {
+                sensor_msgs::LaserScan::ConstPtr scan = m.instantiate<sensor_msgs::LaserScan>();
+                if (!scan || scan->ranges.empty()) {
+                    continue;
+                }
+                std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+                bench.perceive(scan, opts);
+                perception_cycle.record(elapsedNs(start));
+                num_scans++;
+                num_gaps += bench.numGaps();
+
+                if (scan_count++ % opts.plan_every == 0) {
+                    start = std::chrono::steady_clock::now();
+                    num_trajectories += bench.plan();
+                    planning_cycle.record(elapsedNs(start));
+                    num_plans++;
+                }
+            } else if (topic == static_scan_topic) {
+                sensor_msgs::LaserScan::ConstPtr scan = m.instantiate<sensor_msgs::LaserScan>();
+                if (scan) bench.staticScanCB(scan);
+            } else if (topic == odom_topic) {
+                nav_msgs::Odometry::ConstPtr odom = m.instantiate<nav_msgs::Odometry>();
+                if (odom) bench.odomCB(*odom);
+            } else if (topic == acc_topic) {
+                geometry_msgs::Twist::ConstPtr acc = m.instantiate<geometry_msgs::Twist>();
+                if (acc) bench.accCB(*acc);
+            } else if (agent_topics.count(topic) > 0) {
+                nav_msgs::Odometry::ConstPtr odom = m.instantiate<nav_msgs::Odometry>();
+                if (odom) bench.agentOdomCB(agent_topics[topic], *odom);
+            }
+        }
+    }
+    bag.close();
+
+    if (num_scans == 0) {
+        fprintf(stderr, "dynamic_gap_bench: no %s messages in %s\n", scan_topic.c_str(), opts.bag.c_str());
+        return 2;
+    }
+
+    printf("%ld scans, %ld planning cycles, %.2f gaps per scan, %.2f trajectories per cycle\n\n", num_scans, num_plans,
+           (double) num_gaps / num_scans, num_plans > 0 ? (double) num_trajectories / num_plans : 0.0);
+    printf("%-20s %8s %10s %10s %10s %10s %10s %12s\n", "stage", "count", "mean_ms", "p50_ms", "p90_ms", "p99_ms", "max_ms", "calls_per_s");
+    const StageTracer& tracer = StageTracer::get();
+    for (int s = 0; s < NUM_TRACE_STAGES; s++) {
+        if (benchStage((TraceStage) s)) {
+            printRow(traceStageName((TraceStage) s), tracer.histogram((TraceStage) s));
+        }
+    }
+    printRow("perception_cycle", perception_cycle);
+    printRow("planning_cycle", planning_cycle);
+
+    if (!opts.dump_file.empty() && !tracer.dump(opts.dump_file)) {
+        return 2;
+    }
+
+    int status = 0;
+    if (!opts.baseline_file.empty()) {
+        std::map<std::string, double> baseline_p99;
+        if (!readBaseline(opts.baseline_file, baseline_p99)) {
+            fprintf(stderr, "dynamic_gap_bench: could not read baseline %s\n", opts.baseline_file.c_str());
+            return 2;
+        }
+        printf("\n");
+        for (int s = 0; s < NUM_TRACE_STAGES; s++) {
+            const LatencyHistogram& hist = tracer.histogram((TraceStage) s);
+            std::map<std::string, double>::const_iterator base = baseline_p99.find(traceStageName((TraceStage) s));
+            if (!benchStage((TraceStage) s) || hist.count() == 0 || base == baseline_p99.end()) {
+                continue;
+            }
+            double p99 = hist.percentileMs(0.99);
+            bool regressed = p99 > base->second * (1.0 + opts.tolerance);
+            printf("%-20s p99 %10.4f ms, baseline %10.4f ms %s\n", traceStageName((TraceStage) s), p99, base->second,
+                   regressed ? "REGRESSION" : "ok");
+            if (regressed) {
+                status = 1;
+            }
+        }
+    }
+    return status;
+}
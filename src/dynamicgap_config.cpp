@@ -19,6 +19,10 @@ namespace dynamic_gap {
 
         // Gap Association
         nh.param("assoc_thresh", gap_assoc.assoc_thresh, gap_assoc.assoc_thresh);
+        nh.param("model_history_depth", gap_assoc.model_history_depth, gap_assoc.model_history_depth);
+        nh.param("model_history_dir", gap_assoc.model_history_dir, gap_assoc.model_history_dir);
+        nh.param("gated_association", gap_assoc.gated_association, gap_assoc.gated_association);
+        nh.param("angular_association", gap_assoc.angular_association, gap_assoc.angular_association);
 
         // Gap Manipulation
         nh.param("gap_diff", gap_manip.gap_diff, gap_manip.gap_diff);
@@ -77,12 +81,16 @@ namespace dynamic_gap {
         nh.param("niGen_s", planning.niGen_s, planning.niGen_s);
         nh.param("num_feasi_check", planning.num_feasi_check, planning.num_feasi_check);
         nh.param("num_feasi_check", planning.far_feasible, planning.far_feasible);
+        nh.param("parallel_traj_gen", planning.parallel_traj_gen, planning.parallel_traj_gen);
 
         // Trajectory
         nh.param("synthesized_frame", traj.synthesized_frame, traj.synthesized_frame);
         nh.param("scale", traj.scale, traj.scale);
         nh.param("integrate_maxt", traj.integrate_maxt, traj.integrate_maxt);
         nh.param("integrate_stept", traj.integrate_stept, traj.integrate_stept);
+        nh.param("integrator", traj.integrator, traj.integrator);
+        nh.param("integrate_abs_tol", traj.integrate_abs_tol, traj.integrate_abs_tol);
+        nh.param("integrate_rel_tol", traj.integrate_rel_tol, traj.integrate_rel_tol);
         nh.param("rmax", traj.rmax, traj.rmax);
         nh.param("inf_ratio", traj.inf_ratio, traj.inf_ratio);
         nh.param("terminal_weight", traj.terminal_weight, traj.terminal_weight);
@@ -90,6 +98,11 @@ namespace dynamic_gap {
         nh.param("num_curve_points", traj.num_curve_points, traj.num_curve_points);
         nh.param("num_qB_points", traj.num_qB_points, traj.num_qB_points);
 
+        // Tracing
+        nh.param("stage_tracing", tracing.stage_tracing, tracing.stage_tracing);
+        nh.param("stage_tracing_publish_period", tracing.publish_period, tracing.publish_period);
+        nh.param("stage_tracing_dump_file", tracing.dump_file, tracing.dump_file);
+
         // Robot
         nh.param("r_inscr", rbt.r_inscr, rbt.r_inscr);
         nh.param("num_obsts", rbt.num_obsts, rbt.num_obsts);
@@ -109,6 +122,10 @@ namespace dynamic_gap {
 
         // Gap Association
         gap_assoc.assoc_thresh = cfg.assoc_thresh;
+        gap_assoc.model_history_depth = cfg.model_history_depth;
+        gap_assoc.model_history_dir = cfg.model_history_dir;
+        gap_assoc.gated_association = cfg.gated_association;
+        gap_assoc.angular_association = cfg.angular_association;
 
         // Gap Manipulation
         gap_manip.gap_diff = cfg.gap_diff;
@@ -165,17 +182,25 @@ namespace dynamic_gap {
         planning.niGen_s = cfg.niGen_s;
         planning.num_feasi_check = cfg.num_feasi_check;
         planning.far_feasible = cfg.far_feasible;
+        planning.parallel_traj_gen = cfg.parallel_traj_gen;
 
         traj.synthesized_frame = cfg.synthesized_frame;
         traj.scale = cfg.scale;
         traj.integrate_maxt = cfg.integrate_maxt;
         traj.integrate_stept = cfg.integrate_stept;
+        traj.integrator = cfg.integrator;
+        traj.integrate_abs_tol = cfg.integrate_abs_tol;
+        traj.integrate_rel_tol = cfg.integrate_rel_tol;
         traj.rmax = cfg.rmax;
         traj.inf_ratio = cfg.inf_ratio;
         traj.terminal_weight = cfg.terminal_weight;
         traj.waypoint_ratio = cfg.waypoint_ratio;
         traj.num_curve_points = cfg.num_curve_points;
         traj.num_qB_points = cfg.num_qB_points;
+
+        tracing.stage_tracing = cfg.stage_tracing;
+        tracing.publish_period = cfg.stage_tracing_publish_period;
+        tracing.dump_file = cfg.stage_tracing_dump_file;
         
         man.man_ctrl = cfg.man_ctrl;
         man.man_x = cfg.man_x;
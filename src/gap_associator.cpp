@@ -12,12 +12,15 @@
 #include <stdlib.h>
 #include <cfloat> // for DBL_MAX
 #include <cmath>  // for fabs()
+#include <algorithm>
+#include <limits>
+#include <sstream>
 #include <dynamic_gap/gap_associator.h>
 #include <Eigen/Core>
 
 namespace dynamic_gap {
 
-	std::vector< std::vector<float>> obtainGapPoints(std::vector<dynamic_gap::Gap> gaps, std::string ns, bool previous) {
+	std::vector< std::vector<float>> obtainGapPoints(std::vector<dynamic_gap::Gap>& gaps, std::string ns, bool previous) {
 		std::vector< std::vector<float>> points(2*gaps.size(), std::vector<float>(2));
 		int count = 0;
 		for (auto & g : gaps) {	
@@ -40,10 +43,10 @@ namespace dynamic_gap {
 				int lidx = g.LIdx();
 				float rdist = g.RDist();
 				float ldist = g.LDist();
-				left_x = rdist * cos(-((float) g.half_scan - ridx) / g.half_scan * M_PI);
-				left_y = rdist * sin(-((float) g.half_scan - ridx) / g.half_scan * M_PI);
-				right_x = ldist * cos(-((float) g.half_scan - lidx) / g.half_scan * M_PI);
-				right_y = ldist * sin(-((float) g.half_scan - lidx) / g.half_scan * M_PI);				
+				left_x = rdist * g.beams().cosAngle(ridx);
+				left_y = rdist * g.beams().sinAngle(ridx);
+				right_x = ldist * g.beams().cosAngle(lidx);
+				right_y = ldist * g.beams().sinAngle(lidx);				
 			}
 			points[count][0] = left_x;
 			points[count][1] = left_y;
@@ -57,9 +60,11 @@ namespace dynamic_gap {
 		return points;
 	}
 
-	vector<vector<double>> GapAssociator::obtainDistMatrix(std::vector<dynamic_gap::Gap> observed_gaps, 
-															std::vector<dynamic_gap::Gap> previous_gaps, 
-															std::string ns) {
+	void GapAssociator::obtainDistMatrix(std::vector<dynamic_gap::Gap>& observed_gaps, 
+										 std::vector<dynamic_gap::Gap>& previous_gaps, 
+										 std::string ns,
+										 DistMatrix& distMatrix) {
+		ScopedStageTimer trace(TRACE_DIST_MATRIX);
 		double start_time = ros::Time::now().toSec(); 
 		//std::cout << "number of current gaps: " << observed_gaps.size() << std::endl;
 		//std::cout << "number of previous gaps: " << previous_gaps.size() << std::endl;
@@ -68,12 +73,27 @@ namespace dynamic_gap {
 		// ROS_INFO_STREAM("getting current points:");
         observed_gap_points = obtainGapPoints(observed_gaps, ns, false);
         
-		vector< vector<double> > distMatrix(observed_gap_points.size(), vector<double>(previous_gap_points.size()));
+		distMatrix.resize(observed_gap_points.size(), previous_gap_points.size());
+
+		gap_set = (ns == "raw") ? 0 : 1;
+		gated = cfg_->gap_assoc.gated_association;
+		// the angular fast path only needs the pairs within each row's bearing window
+		windowed = !gated && cfg_->gap_assoc.angular_association;
+		if (gated || windowed) {
+			gateDistMatrix(distMatrix);
+			return;
+		}
+		fillDistMatrix(distMatrix);
+
+		// ROS_INFO_STREAM("obtainDistMatrix time elapsed: " << ros::Time::now().toSec() - start_time);
+	}
+
+	void GapAssociator::fillDistMatrix(DistMatrix& distMatrix) {
         //std::cout << "dist matrix size: " << distMatrix.size() << ", " << distMatrix[0].size() << std::endl;
 		// populate distance matrix
 		// ROS_INFO_STREAM("Distance matrix: ");
-        for (int i = 0; i < distMatrix.size(); i++) {
-            for (int j = 0; j < distMatrix[i].size(); j++) {
+        for (int i = 0; i < distMatrix.rows(); i++) {
+            for (int j = 0; j < distMatrix.cols(); j++) {
                 double accum = 0;
                 //std::cout << i << ", " << j <<std::endl;
                 for (int k = 0; k < observed_gap_points[i].size(); k++) {
@@ -81,40 +101,25 @@ namespace dynamic_gap {
                     accum += pow(observed_gap_points[i][k] - previous_gap_points[j][k], 2);
                 }
                 //std::cout << "accum: " << accum << std::endl;
-                distMatrix[i][j] = sqrt(accum);
-                // ROS_INFO_STREAM(distMatrix[i][j] << ", ");
+                distMatrix(i, j) = sqrt(accum);
+                // ROS_INFO_STREAM(distMatrix(i, j) << ", ");
             }
 			// ROS_INFO_STREAM("" << std::endl;
         }
-
-		return distMatrix;
-
-		// ROS_INFO_STREAM("obtainDistMatrix time elapsed: " << ros::Time::now().toSec() - start_time);
 	}
 	
 
 
-	void GapAssociator::assignModels(std::vector<int> association, 
-									 vector< vector<double> > distMatrix, 
+	void GapAssociator::assignModels(const std::vector<int>& association, 
+									 const DistMatrix& distMatrix, 
 									 std::vector<dynamic_gap::Gap>& observed_gaps, 
-									std::vector<dynamic_gap::Gap> previous_gaps,
+									std::vector<dynamic_gap::Gap>& previous_gaps,
 									Matrix<double, 1, 3> v_ego,
 									int * model_idx){
 		double start_time = ros::Time::now().toSec();
-		// initializing models for current gaps
-		double init_r, init_beta;
+		// associating first, so that only gap points without an association need a new model
+		std::vector<bool> associated(observed_gap_points.size(), false);
 
-		for (int i = 0; i < observed_gap_points.size(); i++) {
-			init_r = sqrt(pow(observed_gap_points[i][0], 2) + pow(observed_gap_points[i][1],2));
-			init_beta = std::atan2(observed_gap_points[i][1], observed_gap_points[i][0]);
-			if (i % 2 == 0) {  // curr left
-				observed_gaps[int(std::floor(i / 2.0))].right_model = new dynamic_gap::cart_model("right", *model_idx, init_r, init_beta, v_ego);
-			} else {
-				observed_gaps[int(std::floor(i / 2.0))].left_model = new dynamic_gap::cart_model("left", *model_idx, init_r, init_beta, v_ego);
-			}
-			*model_idx += 1;
-		}
-		
 		// ASSOCIATING MODELS
 		// std::cout << "accepting associations" << std::endl;
 		for (int i = 0; i < association.size(); i++) {
@@ -127,8 +132,9 @@ namespace dynamic_gap {
 
 			
 			// if current gap pt has valid association and association is under distance threshold
-			if (previous_gaps.size() > int(std::floor(pair[1] / 2.0)) && distMatrix[pair[0]][pair[1]] <= assoc_thresh) {
+			if (previous_gaps.size() > int(std::floor(pair[1] / 2.0)) && distMatrix(pair[0], pair[1]) <= assoc_thresh) {
 				//std::cout << "associating" << std::endl;	
+				associated[pair[0]] = true;
 				//std::cout << "distance under threshold" << std::endl;
 				if (pair[0] % 2 == 0) {  // curr left
 					if (pair[1] % 2 == 0) { // prev left
@@ -150,19 +156,82 @@ namespace dynamic_gap {
 			*/
 		}
 
+		// initializing models for current gaps
+		double init_r, init_beta;
+		for (int i = 0; i < observed_gap_points.size(); i++) {
+			if (associated[i]) {
+				continue;
+			}
+
+			init_r = sqrt(pow(observed_gap_points[i][0], 2) + pow(observed_gap_points[i][1],2));
+			init_beta = std::atan2(observed_gap_points[i][1], observed_gap_points[i][0]);
+			dynamic_gap::cart_model* model = model_pool.acquire((i % 2 == 0) ? "right" : "left", *model_idx, init_r, init_beta, v_ego);
+			if (cfg_->gap_assoc.model_history_depth > 0) {
+				model->enable_history(cfg_->gap_assoc.model_history_depth, cfg_->gap_assoc.model_history_dir);
+			}
+
+			if (i % 2 == 0) {  // curr left
+				observed_gaps[int(std::floor(i / 2.0))].right_model = model;
+			} else {
+				observed_gaps[int(std::floor(i / 2.0))].left_model = model;
+			}
+			*model_idx += 1;
+		}
+
+		// previous models that were not carried forward are done with
+		std::vector<dynamic_gap::cart_model*> carried_models;
+		for (dynamic_gap::Gap& g : observed_gaps) {
+			carried_models.push_back(g.left_model);
+			carried_models.push_back(g.right_model);
+		}
+		std::sort(carried_models.begin(), carried_models.end());
+
+		std::vector<dynamic_gap::cart_model*> previous_models;
+		for (dynamic_gap::Gap& g : previous_gaps) {
+			previous_models.push_back(g.left_model);
+			previous_models.push_back(g.right_model);
+		}
+		std::sort(previous_models.begin(), previous_models.end());
+		previous_models.erase(std::unique(previous_models.begin(), previous_models.end()), previous_models.end());
+
+		for (dynamic_gap::cart_model* model : previous_models) {
+			if (!std::binary_search(carried_models.begin(), carried_models.end(), model)) {
+				model_pool.release(model);
+			}
+		}
+
 		//ROS_INFO_STREAM("assignModels time elapsed: " << ros::Time::now().toSec() - start_time); 
 	}
         
 
-	std::vector<int> GapAssociator::associateGaps(vector< vector<double> > distMatrix) {
+	std::vector<int> GapAssociator::associateGaps(DistMatrix& distMatrix) {
+		ScopedStageTimer trace(TRACE_ASSOCIATE_GAPS);
 		// NEW ASSIGNMENT OBTAINED
 		//double start_time = ros::Time::now().toSec();
 
 		// std::cout << "obtaining new assignment" << std::endl;
 		std::vector<int> association;
-        if (distMatrix.size() > 0 && distMatrix[0].size() > 0) {
+        if (!distMatrix.empty()) {
 			//std::cout << "solving" << std::endl;
-            double cost = Solve(distMatrix, association);
+			bool matched = false;
+			if (cfg_->gap_assoc.angular_association) {
+				matched = AngularMatch(distMatrix, association);
+				angular_attempts[gap_set]++;
+				if (!matched) {
+					angular_fallbacks[gap_set]++;
+				}
+			}
+
+			if (matched) {
+				// unambiguous, nothing to solve
+			} else if (gated) {
+				SolveGated(distMatrix, association);
+			} else {
+				if (windowed) {
+					fillDistMatrix(distMatrix);
+				}
+				double cost = Solve(distMatrix, association);
+			}
 			//std::cout << "done solving" << std::endl;
         }
 
@@ -208,10 +277,10 @@ namespace dynamic_gap {
 	//********************************************************//
 	// A single function wrapper for solving assignment problem.
 	//********************************************************//
-	double GapAssociator::Solve(vector <vector<double> >& DistMatrix, vector<int>& Assignment)
+	double GapAssociator::Solve(const DistMatrix& distMatrix, vector<int>& Assignment)
 	{
-		unsigned int nRows = DistMatrix.size();
-		unsigned int nCols = DistMatrix[0].size();
+		unsigned int nRows = distMatrix.rows();
+		unsigned int nCols = distMatrix.cols();
 
 		double *distMatrixIn = new double[nRows * nCols];
 		int *assignment = new int[nRows];
@@ -223,7 +292,7 @@ namespace dynamic_gap {
 		// (i.e. the matrix [1 2; 3 4] will be stored as a vector [1 3 2 4], NOT [1 2 3 4]).
 		for (unsigned int i = 0; i < nRows; i++)
 			for (unsigned int j = 0; j < nCols; j++)
-				distMatrixIn[i + nRows * j] = DistMatrix[i][j];
+				distMatrixIn[i + nRows * j] = distMatrix(i, j);
 		
 		// call solving function
 		assignmentoptimal(assignment, &cost, distMatrixIn, nRows, nCols);
@@ -238,6 +307,284 @@ namespace dynamic_gap {
 	}
 
 
+	//********************************************************//
+	// A previous point q can only be within assoc_thresh of a current point p at range r if their bearings
+	// differ by at most asin(assoc_thresh / r), the distance is at least r * sin of the bearing difference.
+	// previous_bearings holds the previous points sorted by bearing, so the ones that can match current
+	// point i are one or two (when the window wraps around +-pi) contiguous runs of it.
+	//********************************************************//
+	void GapAssociator::sortPreviousBearings()
+	{
+		int nCols = previous_gap_points.size();
+		previous_bearings.resize(nCols);
+		for (int j = 0; j < nCols; j++)
+			previous_bearings[j] = std::make_pair(std::atan2(previous_gap_points[j][1], previous_gap_points[j][0]), j);
+		std::sort(previous_bearings.begin(), previous_bearings.end());
+	}
+
+	void GapAssociator::bearingWindow(int i, std::vector<int>& window)
+	{
+		int nCols = previous_bearings.size();
+		double range = std::sqrt(pow(observed_gap_points[i][0], 2) + pow(observed_gap_points[i][1], 2));
+		double bearing = std::atan2(observed_gap_points[i][1], observed_gap_points[i][0]);
+		window.clear();
+		if (range <= assoc_thresh)
+		{
+			for (int j = 0; j < nCols; j++)
+				window.push_back(j);
+			return;
+		}
+
+		// small slack so rounding in the bearings never gates out a pair right at the threshold
+		double half_width = std::asin(assoc_thresh / range) + 1e-6;
+		double lo = bearing - half_width, hi = bearing + half_width;
+		double ranges[2][2] = {{lo, hi}, {1.0, -1.0}};
+		if (lo < -M_PI)
+		{
+			ranges[0][0] = -M_PI; ranges[0][1] = hi;
+			ranges[1][0] = lo + 2 * M_PI; ranges[1][1] = M_PI;
+		}
+		else if (hi > M_PI)
+		{
+			ranges[0][0] = lo; ranges[0][1] = M_PI;
+			ranges[1][0] = -M_PI; ranges[1][1] = hi - 2 * M_PI;
+		}
+		for (int w = 0; w < 2; w++)
+		{
+			if (ranges[w][0] > ranges[w][1])
+				continue;
+			auto first = std::lower_bound(previous_bearings.begin(), previous_bearings.end(), std::make_pair(ranges[w][0], -1));
+			auto last = std::upper_bound(previous_bearings.begin(), previous_bearings.end(), std::make_pair(ranges[w][1], nCols));
+			for (auto it = first; it < last; it++)
+				window.push_back(it->second);
+		}
+	}
+
+	//********************************************************//
+	// Distance matrix for gated association. Each row only measures the previous points in its bearing
+	// window, everything else stays at infinity and is never a candidate.
+	//********************************************************//
+	void GapAssociator::gateDistMatrix(DistMatrix& distMatrix)
+	{
+		int nRows = observed_gap_points.size();
+		int nCols = previous_gap_points.size();
+		double inf = std::numeric_limits<double>::infinity();
+
+		sortPreviousBearings();
+
+		candidate_start.assign(1, 0);
+		candidate_cols.clear();
+		std::vector<int> window;
+		for (int i = 0; i < nRows; i++)
+		{
+			std::fill(distMatrix.row(i), distMatrix.row(i) + nCols, inf);
+
+			bearingWindow(i, window);
+			std::sort(window.begin(), window.end());
+			for (int j : window)
+			{
+				double accum = 0;
+				for (int k = 0; k < observed_gap_points[i].size(); k++)
+					accum += pow(observed_gap_points[i][k] - previous_gap_points[j][k], 2);
+				double dist = sqrt(accum);
+				if (dist <= assoc_thresh)
+				{
+					distMatrix(i, j) = dist;
+					candidate_cols.push_back(j);
+				}
+			}
+			candidate_start.push_back(candidate_cols.size());
+		}
+	}
+
+	//********************************************************//
+	// Fast path for angular association. Endpoints barely move on the egocircle between scans, so usually
+	// each current endpoint and the nearest previous endpoint in its bearing window are each other's nearest
+	// within assoc_thresh. When that holds for every current endpoint with a candidate, those mutual pairs
+	// are the association and no solver is needed. Returns false as soon as some endpoint's nearest
+	// candidate prefers another endpoint, the caller then falls back to the full solver. Reads only the
+	// candidates gateDistMatrix found, so the whole fast path stays O(n log n).
+	//********************************************************//
+	bool GapAssociator::AngularMatch(const DistMatrix& distMatrix, vector<int>& Assignment)
+	{
+		int nRows = distMatrix.rows();
+		int nCols = distMatrix.cols();
+		Assignment.assign(nRows, -1);
+
+		std::vector<int> nearest_previous(nRows, -1);
+		std::vector<int> nearest_current(nCols, -1);
+		for (int i = 0; i < nRows; i++)
+		{
+			for (int c = candidate_start[i]; c < candidate_start[i + 1]; c++)
+			{
+				int j = candidate_cols[c];
+				double dist = distMatrix(i, j);
+				if (nearest_previous[i] < 0 || dist < distMatrix(i, nearest_previous[i]))
+					nearest_previous[i] = j;
+				if (nearest_current[j] < 0 || dist < distMatrix(nearest_current[j], j))
+					nearest_current[j] = i;
+			}
+		}
+
+		for (int i = 0; i < nRows; i++)
+		{
+			int j = nearest_previous[i];
+			if (j < 0)
+				continue;
+			if (nearest_current[j] != i)
+				return false;
+			Assignment[i] = j;
+		}
+		return true;
+	}
+
+	diagnostic_msgs::DiagnosticStatus GapAssociator::associationDiagnostics() const
+	{
+		diagnostic_msgs::DiagnosticStatus status;
+		status.level = diagnostic_msgs::DiagnosticStatus::OK;
+		status.name = "dynamic_gap: angular association";
+		status.hardware_id = "dynamic_gap";
+		std::ostringstream message;
+		message << "fallback rate";
+
+		// attempts counts the associateGaps calls that tried the fast path
+		const char* gap_set_names[2] = {"raw", "simplified"};
+		for (int s = 0; s < 2; s++)
+		{
+			unsigned long attempts = angular_attempts[s].load(std::memory_order_relaxed);
+			unsigned long fallbacks = angular_fallbacks[s].load(std::memory_order_relaxed);
+			double fallback_rate = (attempts > 0) ? (double) fallbacks / attempts : 0.0;
+			message << (s > 0 ? ", " : " ") << gap_set_names[s] << " " << 100.0 * fallback_rate << " %";
+
+			std::pair<std::string, double> values[] = {
+				std::make_pair(std::string(gap_set_names[s]) + "_attempts", (double) attempts),
+				std::make_pair(std::string(gap_set_names[s]) + "_fallbacks", (double) fallbacks),
+				std::make_pair(std::string(gap_set_names[s]) + "_fallback_rate", fallback_rate)
+			};
+			for (const std::pair<std::string, double>& value : values)
+			{
+				diagnostic_msgs::KeyValue kv;
+				kv.key = value.first;
+				std::ostringstream ss;
+				ss << value.second;
+				kv.value = ss.str();
+				status.values.push_back(kv);
+			}
+		}
+		status.message = message.str();
+		return status;
+	}
+
+	//********************************************************//
+	// Assignment over the gated pairs only, by shortest augmenting paths (Jonker-Volgenant) on the sparse
+	// candidate graph. Every row also has a private dummy column at cost assoc_thresh, so a row is left
+	// unassigned (-1) rather than forced onto a pair that was gated out. Rows are added one at a time; each
+	// runs a Dijkstra search over reduced costs from the new row that stops at the first free column, so
+	// the work stays local to the endpoints that actually compete for the same previous points.
+	//********************************************************//
+	void GapAssociator::SolveGated(const DistMatrix& distMatrix, vector<int>& Assignment)
+	{
+		int nRows = candidate_start.size() - 1;
+		int nCols = distMatrix.cols();
+		int nAllCols = nCols + nRows; // column nCols + i is row i's dummy
+		double inf = std::numeric_limits<double>::infinity();
+
+		std::vector<int> row_col(nRows, -1);      // column assigned to each row
+		std::vector<double> row_cost(nRows, 0.0); // cost of that assignment
+		std::vector<int> col_row(nAllCols, -1);
+		std::vector<double> v(nAllCols, 0.0);     // column potentials
+		std::vector<double> dist(nAllCols, inf);
+		std::vector<int> pred(nAllCols, -1);
+		std::vector<double> pred_cost(nAllCols, 0.0);
+		std::vector<bool> scanned(nAllCols, false);
+		std::vector<int> touched, scanned_cols;
+		std::vector<std::pair<double, int>> heap;
+		auto heap_order = std::greater<std::pair<double, int>>();
+
+		// row i's edges are its candidates plus its dummy
+		auto relax = [&](int i, double base) {
+			for (int c = candidate_start[i]; c <= candidate_start[i + 1]; c++)
+			{
+				bool dummy = (c == candidate_start[i + 1]);
+				int j = dummy ? nCols + i : candidate_cols[c];
+				if (scanned[j])
+					continue;
+				double cost = dummy ? assoc_thresh : distMatrix(i, j);
+				double d = base + cost - v[j];
+				if (d < dist[j])
+				{
+					if (dist[j] == inf)
+						touched.push_back(j);
+					dist[j] = d;
+					pred[j] = i;
+					pred_cost[j] = cost;
+					heap.push_back(std::make_pair(d, j));
+					std::push_heap(heap.begin(), heap.end(), heap_order);
+				}
+			}
+		};
+
+		for (int free_row = 0; free_row < nRows; free_row++)
+		{
+			heap.clear();
+			relax(free_row, 0.0);
+
+			int sink = -1;
+			scanned_cols.clear();
+			while (!heap.empty())
+			{
+				std::pop_heap(heap.begin(), heap.end(), heap_order);
+				std::pair<double, int> top = heap.back();
+				heap.pop_back();
+				int j = top.second;
+				if (scanned[j] || top.first > dist[j])
+					continue;
+				scanned[j] = true;
+				scanned_cols.push_back(j);
+				if (col_row[j] < 0)
+				{
+					sink = j;
+					break;
+				}
+				// continue through the row that holds j, whose reduced cost on j is zero
+				int i = col_row[j];
+				relax(i, dist[j] - (row_cost[i] - v[j]));
+			}
+
+			// the dummy is always reachable, so there is a sink
+			double d_sink = dist[sink];
+			for (int j : scanned_cols)
+				v[j] += dist[j] - d_sink;
+
+			// flip the assignments along the path back to free_row
+			int j = sink;
+			while (true)
+			{
+				int i = pred[j];
+				int next = row_col[i];
+				col_row[j] = i;
+				row_col[i] = j;
+				row_cost[i] = pred_cost[j];
+				if (i == free_row)
+					break;
+				j = next;
+			}
+
+			for (int t : touched)
+			{
+				dist[t] = inf;
+				scanned[t] = false;
+			}
+			touched.clear();
+		}
+
+		Assignment.assign(nRows, -1);
+		for (int i = 0; i < nRows; i++)
+			if (row_col[i] < nCols)
+				Assignment[i] = row_col[i];
+	}
+
+
 	//********************************************************//
 	// Solve optimal solution for assignment problem using Munkres algorithm, also known as Hungarian Algorithm.
 	//********************************************************//
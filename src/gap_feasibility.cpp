@@ -3,10 +3,10 @@
 
 namespace dynamic_gap {
 
-    void GapFeasibilityChecker::updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg_) {
+    void GapFeasibilityChecker::updateEgoCircle(const ScanView& _scan_view) {
         boost::mutex::scoped_lock lock(egolock);
-        msg = msg_;
-        num_of_scan = (int)(msg.get()->ranges.size());
+        scan_view = _scan_view;
+        num_of_scan = scan_view.size();
     }
 
     bool GapFeasibilityChecker::indivGapFeasibilityCheck(dynamic_gap::Gap& gap) {
@@ -123,14 +123,13 @@ namespace dynamic_gap {
  
     double GapFeasibilityChecker::indivGapFindCrossingPoint(dynamic_gap::Gap & gap, Eigen::Vector2f& gap_crossing_point, dynamic_gap::cart_model* left_model, dynamic_gap::cart_model* right_model) {
         //std::cout << "determining crossing point" << std::endl;
-        auto egocircle = *msg.get();
 
         double x_r, x_l, y_r, y_l;
 
-        x_l = (gap.LDist()) * cos(-((double) gap.half_scan - gap.LIdx()) / gap.half_scan * M_PI);
-        y_l = (gap.LDist()) * sin(-((double) gap.half_scan - gap.LIdx()) / gap.half_scan * M_PI);
-        x_r = (gap.RDist()) * cos(-((double) gap.half_scan - gap.RIdx()) / gap.half_scan * M_PI);
-        y_r = (gap.RDist()) * sin(-((double) gap.half_scan - gap.RIdx()) / gap.half_scan * M_PI);
+        x_l = (gap.LDist()) * gap.beams().cosAngle(gap.LIdx());
+        y_l = (gap.LDist()) * gap.beams().sinAngle(gap.LIdx());
+        x_r = (gap.RDist()) * gap.beams().cosAngle(gap.RIdx());
+        y_r = (gap.RDist()) * gap.beams().sinAngle(gap.RIdx());
        
         Eigen::Vector2d left_bearing_vect(x_l / gap.LDist(), y_l / gap.LDist());
         Eigen::Vector2d right_bearing_vect(x_r / gap.RDist(), y_r / gap.RDist());
@@ -311,7 +310,7 @@ namespace dynamic_gap {
 
             // if gap is sufficiently open
             if (r_min * L_to_R_angle > 2 * cfg_->rbt.r_inscr * cfg_->traj.inf_ratio) {
-                auto egocircle = *msg.get();        
+                const sensor_msgs::LaserScan& egocircle = scan_view.scan();
                 
                 double wrapped_beta_left = atanThetaWrap(beta_left);
                 double init_left_idx = (wrapped_beta_left - egocircle.angle_min) / egocircle.angle_increment;
@@ -370,7 +369,7 @@ namespace dynamic_gap {
 
     void GapFeasibilityChecker::generateTerminalPoints(dynamic_gap::Gap & gap, double terminal_beta_left, double terminal_reciprocal_range_left, 
                                                                                  double terminal_beta_right, double terminal_reciprocal_range_right) {
-        auto egocircle = *msg.get();        
+        const sensor_msgs::LaserScan& egocircle = scan_view.scan();
         
         double wrapped_term_beta_left = atanThetaWrap(terminal_beta_left);
         float init_left_idx = (terminal_beta_left - egocircle.angle_min) / egocircle.angle_increment;
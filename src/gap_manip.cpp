@@ -1,9 +1,10 @@
 #include <dynamic_gap/gap_manip.h>
 
 namespace dynamic_gap {
-    void GapManipulator::updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg_) {
+    void GapManipulator::updateEgoCircle(const ScanView& _scan_view) {
         boost::mutex::scoped_lock lock(egolock);
-        msg = msg_;
+        scan_view = _scan_view;
+        msg = scan_view.ptr();
         num_of_scan = (int)(msg.get()->ranges.size());
         half_num_scan = num_of_scan / 2;
         angle_min = static_msg.get()->angle_min;
@@ -20,26 +21,16 @@ namespace dynamic_gap {
         angle_increment = static_msg.get()->angle_increment;
     }
 
-    void GapManipulator::updateDynamicEgoCircle(std::vector<dynamic_gap::Gap> curr_raw_gaps, 
-                                                dynamic_gap::Gap& gap,
-                                                std::vector<std::vector<double>> & _agent_odoms, 
-                                                std::vector<std::vector<double>> _agent_vels,
+    void GapManipulator::updateDynamicEgoCircle(dynamic_gap::Gap& gap,
                                                 dynamic_gap::TrajectoryArbiter * trajArbiter) {
-        dynamic_scan = *static_msg.get();
-        double t_i = 0.0;
-        double t_iplus1 = gap.gap_lifespan;
-        /*
-
-        std::vector<dynamic_gap::cart_model *> raw_models;
-        for (auto gap : curr_raw_gaps) {
-            raw_models.push_back(gap.left_model);
-            raw_models.push_back(gap.right_model);
+        // egocircle at the end of the gap lifespan comes from the arbiter's per-cycle cache
+        if (!trajArbiter->hasDynamicEgocircleCache()) {
+            ROS_WARN_STREAM("updateDynamicEgoCircle: dynamic egocircle cache not built");
+            return;
         }
-        */
-
-        trajArbiter->recoverDynamicEgocircleCheat(t_i, t_iplus1, _agent_odoms, _agent_vels, dynamic_scan, false);
+        dynamic_scan = trajArbiter->getCachedDynamicEgocircle(gap.gap_lifespan);
 
-        auto terminal_min_dist = *std::min_element(dynamic_scan.ranges.begin(), dynamic_scan.ranges.end());
+        auto terminal_min_dist = trajArbiter->getCachedDynamicEgocircleMin(gap.gap_lifespan);
         gap.setTerminalMinSafeDist(terminal_min_dist);
         // trajArbiter->recoverDynamicEgoCircle(t_i, t_iplus1, raw_models, dynamic_scan);
     }
@@ -183,7 +174,7 @@ namespace dynamic_gap {
             return;
         }
 
-        sensor_msgs::LaserScan stored_scan_msgs = *msg.get(); // initial ? *msg.get() : dynamic_laser_scan;
+        const sensor_msgs::LaserScan& stored_scan_msgs = *msg.get(); // initial ? *msg.get() : dynamic_laser_scan;
         float goal_orientation = std::atan2(localgoal.pose.position.y, localgoal.pose.position.x);
         double local_goal_idx = std::floor(goal_orientation*half_num_scan/M_PI + half_num_scan);
         ROS_INFO_STREAM("local goal idx: " << local_goal_idx << ", local goal x/y: (" << localgoal.pose.position.x << ", " << localgoal.pose.position.y << ")");
@@ -191,7 +182,7 @@ namespace dynamic_gap {
         // ROS_INFO_STREAM("goal_vis: " << goal_vis << ", " << goal_in_range);
         
         if (goal_within_gap_angle) {
-            bool goal_vis = checkGoalVisibility(localgoal, theta_r, theta_l, rdist, ldist, stored_scan_msgs); // is localgoal within gap range
+            bool goal_vis = checkGoalVisibility(localgoal, theta_r, theta_l, rdist, ldist, scan_view); // is localgoal within gap range
             if (goal_vis) {
                 ROS_INFO_STREAM("Option 2: local goal");
 
@@ -294,13 +285,13 @@ namespace dynamic_gap {
         }
     }
 
-    bool GapManipulator::checkGoalVisibility(geometry_msgs::PoseStamped localgoal, float theta_r, float theta_l, float rdist, float ldist, sensor_msgs::LaserScan const scan) {
+    bool GapManipulator::checkGoalVisibility(geometry_msgs::PoseStamped localgoal, float theta_r, float theta_l, float rdist, float ldist, const ScanView& scan) {
         boost::mutex::scoped_lock lock(egolock);
         // with robot as 0,0 (localgoal in robot frame as well)
         float dist2goal = sqrt(pow(localgoal.pose.position.x, 2) + pow(localgoal.pose.position.y, 2));
 
         // auto scan = *msg.get();
-        auto min_val = *std::min_element(scan.ranges.begin(), scan.ranges.end());
+        auto min_val = scan.minRange();
 
         // If sufficiently close to robot
         if (dist2goal < 2 * cfg_->rbt.r_inscr) {
@@ -314,7 +305,7 @@ namespace dynamic_gap {
 
         // Should be sufficiently far, otherwise we are in trouble
         float goal_angle = std::atan2(localgoal.pose.position.y, localgoal.pose.position.x);
-        int goal_index = (int) round((goal_angle - scan.angle_min) / scan.angle_increment);
+        int goal_index = (int) round((goal_angle - scan.angleMin()) / scan.angleIncrement());
 
         // get gap's range at localgoal idx
         Eigen::Vector2f left_norm_vect(std::cos(theta_l), std::sin(theta_l));
@@ -327,11 +318,11 @@ namespace dynamic_gap {
 
         /*
         float half_angle = std::asin(cfg_->rbt.r_inscr / dist2goal);
-        // int index = std::ceil(half_angle / scan.angle_increment) * 1.5;
-        int index = (int)(scan.ranges.size()) / 8;
+        // int index = std::ceil(half_angle / scan.angleIncrement()) * 1.5;
+        int index = scan.size() / 8;
         int lower_bound = goal_index - index;
         int upper_bound = goal_index + index;
-        float min_val_round_goal = *std::min_element(scan.ranges.begin() + lower_bound, scan.ranges.begin() + upper_bound);
+        float min_val_round_goal = scan.minRange(lower_bound, upper_bound);
         */
 
         return dist2goal < localgoal_r;
@@ -467,7 +458,7 @@ namespace dynamic_gap {
         }
         ROS_INFO_STREAM("~running convertAxialGap~");
 
-        sensor_msgs::LaserScan stored_scan_msgs = initial ? *msg.get() : dynamic_scan;
+        const sensor_msgs::LaserScan& stored_scan_msgs = initial ? *msg.get() : dynamic_scan;
         if (stored_scan_msgs.ranges.size() != 512) {
             ROS_FATAL_STREAM("Scan range incorrect gap manip");
         }
@@ -673,7 +664,7 @@ namespace dynamic_gap {
 
         ROS_INFO_STREAM("running radialExtendGap");
 
-        sensor_msgs::LaserScan stored_scan_msgs = initial ? *msg.get() : dynamic_scan;
+        const sensor_msgs::LaserScan& stored_scan_msgs = initial ? *msg.get() : dynamic_scan;
         // int half_num_scan = gap.half_scan; // changing this
         
         int lidx = initial ? gap.cvx_LIdx() : gap.cvx_term_LIdx();
@@ -872,7 +863,7 @@ namespace dynamic_gap {
         float new_L_to_R_angle = getLeftToRightAngle(new_left_norm_vect_robot, new_right_norm_vect_robot);
         ROS_INFO_STREAM("new_L_to_R_angle: " << new_L_to_R_angle);
 
-        sensor_msgs::LaserScan stored_scan_msgs = *msg.get(); // initial ? *msg.get() : dynamic_scan;
+        const sensor_msgs::LaserScan& stored_scan_msgs = *msg.get(); // initial ? *msg.get() : dynamic_scan;
         int new_r_idx, new_l_idx;
         float range_l_p, range_r_p;
         if (new_L_to_R_angle < 0) {
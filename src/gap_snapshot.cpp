@@ -0,0 +1,52 @@
+#include <dynamic_gap/gap_snapshot.h>
+
+namespace dynamic_gap {
+    GapSetSnapshot::GapSetSnapshot(const std::vector<dynamic_gap::Gap>& _raw_gaps,
+                                   const std::vector<dynamic_gap::Gap>& _observed_gaps,
+                                   const std::vector<int>& _raw_association,
+                                   const std::vector<int>& _simp_association,
+                                   const ScanView& _scan,
+                                   const geometry_msgs::PoseStamped& _local_goal,
+                                   ros::Time _stamp)
+        : raw_gaps(_raw_gaps), observed_gaps(_observed_gaps),
+          raw_association(_raw_association), simp_association(_simp_association),
+          scan(_scan), local_goal(_local_goal), stamp(_stamp) {
+        // a model can be shared by several gaps, so copy each one once and repoint every gap at the copy
+        std::map<dynamic_gap::cart_model*, dynamic_gap::cart_model*> copies;
+        for (dynamic_gap::Gap& g : raw_gaps) {
+            g.left_model = copyModel(g.left_model, copies);
+            g.right_model = copyModel(g.right_model, copies);
+        }
+
+        for (dynamic_gap::Gap& g : observed_gaps) {
+            g.left_model = copyModel(g.left_model, copies);
+            g.right_model = copyModel(g.right_model, copies);
+        }
+    }
+
+    dynamic_gap::cart_model* GapSetSnapshot::copyModel(dynamic_gap::cart_model* live,
+                                                       std::map<dynamic_gap::cart_model*, dynamic_gap::cart_model*>& copies) {
+        if (live == NULL) {
+            return NULL;
+        }
+
+        auto it = copies.find(live);
+        if (it != copies.end()) {
+            return it->second;
+        }
+
+        boost::shared_ptr<dynamic_gap::cart_model> copy(new dynamic_gap::cart_model(*live));
+        models.push_back(copy);
+        copies[live] = copy.get();
+        return copy.get();
+    }
+
+    dynamic_gap::cart_model* GapSetSnapshot::findModel(int index) const {
+        for (const boost::shared_ptr<dynamic_gap::cart_model>& model : models) {
+            if (model->get_index() == index) {
+                return model.get();
+            }
+        }
+        return NULL;
+    }
+}
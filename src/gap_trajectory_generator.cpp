@@ -6,6 +6,7 @@ namespace dynamic_gap{
                                                     geometry_msgs::PoseStamped curr_pose, 
                                                     geometry_msgs::Twist curr_vel,
                                                     bool run_g2g) {
+        ScopedStageTimer trace(TRACE_GENERATE_TRAJECTORY);
         try {        
             // return geometry_msgs::PoseArray();
             geometry_msgs::PoseArray posearr;
@@ -13,22 +14,24 @@ namespace dynamic_gap{
             double gen_traj_start_time = ros::Time::now().toSec();
             posearr.header.stamp = ros::Time::now();
             double coefs = cfg_->traj.scale;
-            write_trajectory corder(posearr, cfg_->robot_frame_id, coefs, timearr);
+            // integrator output goes to this thread's buffers, posearr is filled once integration is done
+            trajectory_buffer& buffer = getThreadTrajectoryBuffer();
+            write_trajectory corder(buffer, coefs);
             posearr.header.frame_id = cfg_->traj.synthesized_frame ? cfg_->sensor_frame_id : cfg_->robot_frame_id;
 
             Eigen::Vector4d ego_x(curr_pose.pose.position.x + 1e-5, curr_pose.pose.position.y + 1e-6,
                                   curr_vel.linear.x, curr_vel.linear.y);
 
             // get gap points in cartesian
-            float x_left = selectedGap.cvx_LDist() * cos(((float) selectedGap.cvx_LIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
-            float y_left = selectedGap.cvx_LDist() * sin(((float) selectedGap.cvx_LIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
-            float x_right = selectedGap.cvx_RDist() * cos(((float) selectedGap.cvx_RIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
-            float y_right = selectedGap.cvx_RDist() * sin(((float) selectedGap.cvx_RIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
+            float x_left = selectedGap.cvx_LDist() * selectedGap.beams().cosAngle(selectedGap.cvx_LIdx());
+            float y_left = selectedGap.cvx_LDist() * selectedGap.beams().sinAngle(selectedGap.cvx_LIdx());
+            float x_right = selectedGap.cvx_RDist() * selectedGap.beams().cosAngle(selectedGap.cvx_RIdx());
+            float y_right = selectedGap.cvx_RDist() * selectedGap.beams().sinAngle(selectedGap.cvx_RIdx());
 
-            float term_x_left = selectedGap.cvx_term_LDist() * cos(((float) selectedGap.cvx_term_LIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
-            float term_y_left = selectedGap.cvx_term_LDist() * sin(((float) selectedGap.cvx_term_LIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
-            float term_x_right = selectedGap.cvx_term_RDist() * cos(((float) selectedGap.cvx_term_RIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
-            float term_y_right = selectedGap.cvx_term_RDist() * sin(((float) selectedGap.cvx_term_RIdx() - selectedGap.half_scan) / selectedGap.half_scan * M_PI);
+            float term_x_left = selectedGap.cvx_term_LDist() * selectedGap.beams().cosAngle(selectedGap.cvx_term_LIdx());
+            float term_y_left = selectedGap.cvx_term_LDist() * selectedGap.beams().sinAngle(selectedGap.cvx_term_LIdx());
+            float term_x_right = selectedGap.cvx_term_RDist() * selectedGap.beams().cosAngle(selectedGap.cvx_term_RIdx());
+            float term_y_right = selectedGap.cvx_term_RDist() * selectedGap.beams().sinAngle(selectedGap.cvx_term_RIdx());
 
             if (run_g2g) { //   || selectedGap.goal.goalwithin
                 state_type x = {ego_x[0], ego_x[1], ego_x[2], ego_x[3],
@@ -39,11 +42,10 @@ namespace dynamic_gap{
                 g2g inte_g2g(selectedGap.goal.x, selectedGap.goal.y,
                              selectedGap.terminal_goal.x, selectedGap.terminal_goal.y,
                              selectedGap.gap_lifespan, cfg_->control.vx_absmax);
-                boost::numeric::odeint::integrate_const(boost::numeric::odeint::euler<state_type>(),
-                inte_g2g, x, 0.0,
-                cfg_->traj.integrate_maxt,
-                cfg_->traj.integrate_stept,
-                corder);
+                buffer.reset(cfg_->traj.integrate_maxt, cfg_->traj.integrate_stept);
+                integrate_trajectory(inte_g2g, x, cfg_->traj.integrate_maxt, cfg_->traj.integrate_stept,
+                                     cfg_->traj.integrator, cfg_->traj.integrate_abs_tol, cfg_->traj.integrate_rel_tol, corder);
+                buffer.toPoseArray(posearr, timearr);
                 std::tuple<geometry_msgs::PoseArray, std::vector<double>> return_tuple(posearr, timearr);
                 return return_tuple;
             }
@@ -140,15 +142,22 @@ namespace dynamic_gap{
             selectedGap.left_right_centers = left_right_centers;
             selectedGap.all_curve_pts = all_curve_pts;
 
+            // same associated gap keeps the same model indices between cycles
+            std::pair<int, int> warm_start_key(-1, -1);
+            if (selectedGap.left_model != NULL && selectedGap.right_model != NULL) {
+                warm_start_key = std::make_pair(selectedGap.left_model->get_index(), selectedGap.right_model->get_index());
+            }
+
             reachable_gap_APF reachable_gap_APF_inte(init_rbt_pos, goal_pt_1, cfg_->gap_manip.K_acc,
                                                     cfg_->control.vx_absmax, nom_acc, num_curve_points, num_qB_points,
                                                     all_curve_pts, all_centers, all_inward_norms, 
-                                                    left_weight, right_weight, selectedGap.gap_lifespan);   
+                                                    left_weight, right_weight, selectedGap.gap_lifespan, warm_start_key);   
             
             start_time = ros::Time::now().toSec();
-            boost::numeric::odeint::integrate_const(boost::numeric::odeint::euler<state_type>(),
-                                                    reachable_gap_APF_inte, x, 0.0, selectedGap.gap_lifespan, 
-                                                    cfg_->traj.integrate_stept, corder);
+            buffer.reset(selectedGap.gap_lifespan, cfg_->traj.integrate_stept);
+            integrate_trajectory(reachable_gap_APF_inte, x, selectedGap.gap_lifespan, cfg_->traj.integrate_stept,
+                                 cfg_->traj.integrator, cfg_->traj.integrate_abs_tol, cfg_->traj.integrate_rel_tol, corder);
+            buffer.toPoseArray(posearr, timearr);
             ROS_INFO_STREAM("integration time elapsed: " << (ros::Time::now().toSec() - start_time));
 
             std::tuple<geometry_msgs::PoseArray, std::vector<double>> return_tuple(posearr, timearr);
@@ -331,19 +340,9 @@ namespace dynamic_gap{
         geometry_msgs::PoseArray posearr,
         geometry_msgs::TransformStamped planning2odom)
     {
-        geometry_msgs::PoseArray retarr;
-        geometry_msgs::PoseStamped outplaceholder;
-        outplaceholder.header.frame_id = cfg_->odom_frame_id;
-        geometry_msgs::PoseStamped inplaceholder;
-        inplaceholder.header.frame_id = cfg_->robot_frame_id;
-        for (const auto pose : posearr.poses)
-        {
-            inplaceholder.pose = pose;
-            tf2::doTransform(inplaceholder, outplaceholder, planning2odom);
-            retarr.poses.push_back(outplaceholder.pose);
-        }
+        // planar transform of every pose, no per pose tf2 / PoseStamped round trip
+        geometry_msgs::PoseArray retarr = Trajectory2D(posearr, std::vector<double>()).transformed(planning2odom).toPoseArray();
         retarr.header.frame_id = cfg_->odom_frame_id;
-        retarr.header.stamp = ros::Time::now();
         // ROS_WARN_STREAM("leaving transform back with length: " << retarr.poses.size());
         return retarr;
     }
@@ -9,19 +9,27 @@ namespace dynamic_gap {
         cfg_ = & cfg;
     }
 
-    std::vector<dynamic_gap::Gap> GapUtils::hybridScanGap(boost::shared_ptr<sensor_msgs::LaserScan const> sharedPtr_laser, geometry_msgs::PoseStamped final_goal_rbt)
+    void GapUtils::findGaps(const ScanView& scan_view,
+                            geometry_msgs::PoseStamped final_goal_rbt,
+                            std::vector<dynamic_gap::Gap>& raw_gaps,
+                            std::vector<dynamic_gap::Gap>& simplified_gaps) {
+        raw_gaps = hybridScanGap(scan_view, final_goal_rbt);
+        simplified_gaps = mergeGapsOneGo(scan_view, raw_gaps);
+    }
+
+    std::vector<dynamic_gap::Gap> GapUtils::hybridScanGap(const ScanView& scan_view, geometry_msgs::PoseStamped final_goal_rbt)
     {
+        ScopedStageTimer trace(TRACE_HYBRID_SCAN_GAP);
         // ROS_INFO_STREAM("running hybridScanGap");
         // clear gaps
         double start_time = ros::Time::now().toSec();
         std::vector<dynamic_gap::Gap> raw_gaps;
-        sensor_msgs::LaserScan stored_scan_msgs = *sharedPtr_laser.get();
+        const sensor_msgs::LaserScan& stored_scan_msgs = scan_view.scan();
         // get half scan value
         float half_scan = float(stored_scan_msgs.ranges.size() / 2);
         bool prev = true;
-        auto max_dist_iter = std::max_element(stored_scan_msgs.ranges.begin(), stored_scan_msgs.ranges.end());
-        float max_scan_dist = *max_dist_iter;
-        auto min_dist = *std::min_element(stored_scan_msgs.ranges.begin(), stored_scan_msgs.ranges.end());
+        float max_scan_dist = scan_view.maxRange();
+        auto min_dist = scan_view.minRange();
         // ROS_INFO_STREAM("hybridScanGap min_dist: " << min_dist);
         int gap_size = 0;
         std::string frame = stored_scan_msgs.header.frame_id;
@@ -164,7 +172,7 @@ namespace dynamic_gap {
             double scan_dist = stored_scan_msgs.ranges.at(final_goal_idx);
             
             if (final_goal_dist < scan_dist) {
-                raw_gaps = addTerminalGoal(final_goal_idx, raw_gaps, stored_scan_msgs);
+                raw_gaps = addTerminalGoal(final_goal_idx, raw_gaps, scan_view);
             }
         }
 
@@ -173,14 +181,15 @@ namespace dynamic_gap {
 
     std::vector<dynamic_gap::Gap> GapUtils::addTerminalGoal(int final_goal_idx,
                                                             std::vector<dynamic_gap::Gap> &raw_gaps,
-                                                            sensor_msgs::LaserScan stored_scan_msgs) {
+                                                            const ScanView& scan_view) {
         ROS_INFO_STREAM("running addTerminalGoal");
         ROS_INFO_STREAM("final_goal_idx: " << final_goal_idx);
+        const sensor_msgs::LaserScan& stored_scan_msgs = scan_view.scan();
         int gap_idx = 0;
         int half_num_scan = stored_scan_msgs.ranges.size() / 2;
-        auto min_dist = *std::min_element(stored_scan_msgs.ranges.begin(), stored_scan_msgs.ranges.end());
+        auto min_dist = scan_view.minRange();
 
-        for (dynamic_gap::Gap g : raw_gaps) {
+        for (dynamic_gap::Gap & g : raw_gaps) {
             // if final_goal idx is within gap, return
             // ROS_INFO_STREAM("checking against: " << g.RIdx() << " to " << g.LIdx());
             if (final_goal_idx >= g.RIdx() && final_goal_idx <= g.LIdx()) {
@@ -205,13 +214,14 @@ namespace dynamic_gap {
     }    
 
     std::vector<dynamic_gap::Gap> GapUtils::mergeGapsOneGo(
-        boost::shared_ptr<sensor_msgs::LaserScan const> sharedPtr_laser,
+        const ScanView& scan_view,
         std::vector<dynamic_gap::Gap>& raw_gaps)
     {
+        ScopedStageTimer trace(TRACE_MERGE_GAPS);
         //double start_time = ros::Time::now().toSec();
         std::vector<dynamic_gap::Gap> simplified_gaps;
 
-        sensor_msgs::LaserScan stored_scan_msgs = *sharedPtr_laser.get();
+        const sensor_msgs::LaserScan& stored_scan_msgs = scan_view.scan();
 
         // Insert first
         bool mark_to_start = true;
@@ -224,6 +234,17 @@ namespace dynamic_gap {
         float curr_rdist = 0.0;
         int erase_counter = 0;
         int last_mergable = -1;
+        // simplified gaps sorted by both indices, true until the wrapped/terminal goal gaps at the end of
+        // the raw list land in it. While sorted, the far side minimum and the index spread against the
+        // current raw gap only get worse going backwards, so the merge search can stop at the first failure.
+        bool sorted = true;
+        auto checkSorted = [&simplified_gaps, &sorted]() {
+            int n = simplified_gaps.size();
+            if (n > 1 && (simplified_gaps[n - 1].LIdx() < simplified_gaps[n - 2].LIdx() ||
+                          simplified_gaps[n - 1].RIdx() < simplified_gaps[n - 2].RIdx())) {
+                sorted = false;
+            }
+        };
         // ROS_INFO_STREAM("running MergeGapsOneGo: ");
         for (int i = 0; i < num_raw_gaps; i++)
         {
@@ -262,8 +283,8 @@ namespace dynamic_gap {
                                 // ROS_INFO_STREAM("points: (" << simplified_gaps[j].RIdx() << ", " << simplified_gaps[j].RDist() << ") to (" << simplified_gaps[j].LIdx() << ", " << simplified_gaps[j].LDist() << ")");
                                 start_idx = std::min(simplified_gaps[j].LIdx(), raw_gaps[i].RIdx());
                                 end_idx = std::max(simplified_gaps[j].LIdx(), raw_gaps[i].RIdx());
-                                auto farside_iter = std::min_element(stored_scan_msgs.ranges.begin() + start_idx, stored_scan_msgs.ranges.begin() + end_idx);
-                                float min_dist = *farside_iter;
+                                // an empty range reads the beam at end_idx, as min_element over it did
+                                float min_dist = start_idx < end_idx ? scan_view.minRange(start_idx, end_idx) : stored_scan_msgs.ranges[end_idx];
                                 // second test is checking if simplified gap dist is less than current min dist of raw gap
                                 // Changed this from - to + to make merging easier
                                 bool simp_left_raw_right_dist_test = curr_rdist <= (min_dist - coefs * cfg_->rbt.r_inscr) && 
@@ -276,7 +297,10 @@ namespace dynamic_gap {
                                 // ROS_INFO_STREAM("simp_left_raw_right_dist_test: " << simp_left_raw_right_dist_test << ", left_or_radial: " << left_or_radial << ", idx_diff: " << idx_diff);
                                 if (simp_left_raw_right_dist_test && left_or_radial && idx_diff) {
                                     last_mergable = j;
-                                } 
+                                } else if (sorted && simplified_gaps[j].LIdx() < raw_gaps[i].RIdx() &&
+                                           (!idx_diff || curr_rdist > (min_dist - coefs * cfg_->rbt.r_inscr))) {
+                                    break;
+                                }
                             }
 
                             if (last_mergable != -1) {
@@ -313,6 +337,8 @@ namespace dynamic_gap {
                     // ROS_INFO_STREAM("before marking start, adding raw gap: (" << raw_gaps[i].RIdx() << ", " << raw_gaps[i].RDist() << ") to (" << raw_gaps[i].LIdx() << ", " << raw_gaps[i].LDist() << ")");                            
                 }
             }
+            // each raw gap only appends to or extends the back of the simplified gaps
+            checkSorted();
             last_type_left = raw_gaps[i].isRightType();
             // ROS_INFO_STREAM("---");
         }
@@ -16,9 +16,9 @@ namespace dynamic_gap {
         // transform plan to robot frame such as base_link
     }
 
-    void GoalSelector::updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg) {
+    void GoalSelector::updateEgoCircle(const ScanView& _scan_view) {
         boost::mutex::scoped_lock lock(lscan_mutex);
-        sharedPtr_laser = msg;
+        scan_view = _scan_view;
     }
 
     void GoalSelector::updateLocalGoal(geometry_msgs::TransformStamped map2rbt) {
@@ -27,7 +27,7 @@ namespace dynamic_gap {
             return;
         }
 
-        if ((*sharedPtr_laser.get()).ranges.size() < 500) {
+        if (scan_view.size() < 500) {
             ROS_FATAL_STREAM("Scan range incorrect goalselector");
         }
 
@@ -61,7 +61,7 @@ namespace dynamic_gap {
     bool GoalSelector::NoTVisibleOrPossiblyObstructed(geometry_msgs::PoseStamped pose) {
         int laserScanIdx = PoseIndexInSensorMsg(pose);
         float epsilon2 = float(cfg_->gap_manip.epsilon2);
-        sensor_msgs::LaserScan stored_scan_msgs = *sharedPtr_laser.get();
+        const sensor_msgs::LaserScan& stored_scan_msgs = scan_view.scan();
         // this boolean is flipped from VisibleOrPossiblyObstructed. 
         bool check = dist2rbt(pose) > (double (stored_scan_msgs.ranges.at(laserScanIdx)) - cfg_->rbt.r_inscr / 2);
         return check;
@@ -71,7 +71,7 @@ namespace dynamic_gap {
     bool GoalSelector::VisibleOrPossiblyObstructed(geometry_msgs::PoseStamped pose) {
         int laserScanIdx = PoseIndexInSensorMsg(pose);
         float epsilon2 = float(cfg_->gap_manip.epsilon2);
-        sensor_msgs::LaserScan stored_scan_msgs = *sharedPtr_laser.get();
+        const sensor_msgs::LaserScan& stored_scan_msgs = scan_view.scan();
         // first piece of bool: is the distance from pose to rbt less than laserscan range - robot diameter (z-buffer idea)
         // second piece of bool: distance from pose to rbt greater than laserscan range + some epsilon*2 (obstructed?)
         bool check = dist2rbt(pose) < (double (stored_scan_msgs.ranges.at(laserScanIdx)) - cfg_->rbt.r_inscr / 2) || 
@@ -81,7 +81,7 @@ namespace dynamic_gap {
 
     int GoalSelector::PoseIndexInSensorMsg(geometry_msgs::PoseStamped pose) {
         auto orientation = getPoseOrientation(pose);
-        auto index = float(orientation + M_PI) / (sharedPtr_laser.get()->angle_increment);
+        auto index = float(orientation + M_PI) / scan_view.angleIncrement();
         return int(std::floor(index));
     }
 
@@ -112,8 +112,8 @@ namespace dynamic_gap {
         // distance: distance to robot at each index of plan
         // need indices: laser scan index at each index of plan
         // Finding the largest distance in the laser scan
-        sensor_msgs::LaserScan stored_scan_msgs = *sharedPtr_laser.get();
-        threshold = (double) *std::max_element(stored_scan_msgs.ranges.begin(), stored_scan_msgs.ranges.end());
+        const sensor_msgs::LaserScan& stored_scan_msgs = scan_view.scan();
+        threshold = (double) scan_view.maxRange();
 
         // ROS_INFO_STREAM("mod plan size: " << mod_plan.size());
         std::vector<double> plan_dists(mod_plan.size());
@@ -159,7 +159,7 @@ namespace dynamic_gap {
         return sqrt(pow(pose.pose.position.x, 2) + pow(pose.pose.position.y, 2));
     }
 
-    double GoalSelector::scanDistsAtPlanIndices(geometry_msgs::PoseStamped pose, sensor_msgs::LaserScan stored_scan_msgs) {
+    double GoalSelector::scanDistsAtPlanIndices(geometry_msgs::PoseStamped pose, const sensor_msgs::LaserScan& stored_scan_msgs) {
         double plan_theta = atan2(pose.pose.position.y, pose.pose.position.x);
         int half_num_scan = stored_scan_msgs.ranges.size() / 2;
         int plan_idx = int (half_num_scan * plan_theta / M_PI) + half_num_scan;
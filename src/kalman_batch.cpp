@@ -0,0 +1,202 @@
+#include <dynamic_gap/kalman_batch.h>
+
+namespace dynamic_gap {
+    void KalmanBatch::add(dynamic_gap::cart_model* model, const Matrix<double, 2, 1> & range_bearing_measurement) {
+        models.push_back(model);
+        ranges.push_back(range_bearing_measurement[0]);
+        bearings.push_back(range_bearing_measurement[1]);
+    }
+
+    void KalmanBatch::update(const Matrix<double, 1, 3> & a_ego, const Matrix<double, 1, 3> & v_ego,
+                             const std::vector< std::vector<double>> & agent_odoms,
+                             const std::vector< std::vector<double>> & agent_vels,
+                             double t) {
+        if (!models.empty()) {
+            gather(a_ego, v_ego, agent_odoms, agent_vels, t);
+            propagate(v_ego[2], a_ego[0], a_ego[1]);
+            scatter();
+        }
+
+        models.clear();
+        ranges.clear();
+        bearings.clear();
+    }
+
+    void KalmanBatch::gather(const Matrix<double, 1, 3> & a_ego, const Matrix<double, 1, 3> & v_ego,
+                             const std::vector< std::vector<double>> & agent_odoms,
+                             const std::vector< std::vector<double>> & agent_vels,
+                             double t) {
+        int n = models.size();
+        for (int e = 0; e < 4; e++) x[e].resize(n);
+        for (int e = 0; e < 16; e++) P[e].resize(n);
+        for (int e = 0; e < 8; e++) G[e].resize(n);
+        for (int e = 0; e < 4; e++) R[e].resize(n);
+        for (int e = 0; e < 2; e++) x_tilde[e].resize(n);
+        for (int e = 0; e < 3; e++) {
+            dQ_0[e].resize(n);
+            dQ_1[e].resize(n);
+            dQ_2[e].resize(n);
+        }
+        cos_w_dt.resize(n);
+        sin_w_dt.resize(n);
+        dt.resize(n);
+
+        Matrix<double, 2, 1> measurement;
+        for (int k = 0; k < n; k++) {
+            dynamic_gap::cart_model* model = models[k];
+            measurement << ranges[k], bearings[k];
+            model->begin_update(measurement, a_ego, v_ego, false, agent_odoms, agent_vels, t);
+            // the transition and process noise matrices need trig of each model's own dt, so they are
+            // built per model and only their distinct entries are gathered
+            model->linearize();
+            model->discretizeQ();
+
+            for (int i = 0; i < 4; i++) {
+                x[i][k] = model->x[i];
+                for (int j = 0; j < 4; j++) {
+                    P[i*4 + j][k] = model->P(i, j);
+                }
+                for (int j = 0; j < 2; j++) {
+                    G[i*2 + j][k] = model->G(i, j);
+                }
+            }
+            for (int i = 0; i < 2; i++) {
+                for (int j = 0; j < 2; j++) {
+                    R[i*2 + j][k] = model->R(i, j);
+                }
+                x_tilde[i][k] = model->x_tilde[i];
+            }
+            cos_w_dt[k] = model->STM(0, 0);
+            sin_w_dt[k] = model->STM(0, 1);
+            dQ_2[0][k] = model->dQ(0, 0); dQ_2[1][k] = model->dQ(0, 1); dQ_2[2][k] = model->dQ(1, 1);
+            dQ_1[0][k] = model->dQ(0, 2); dQ_1[1][k] = model->dQ(0, 3); dQ_1[2][k] = model->dQ(1, 3);
+            dQ_0[0][k] = model->dQ(2, 2); dQ_0[1][k] = model->dQ(2, 3); dQ_0[2][k] = model->dQ(3, 3);
+            dt[k] = model->dt;
+        }
+    }
+
+    // cart_model::kf_update_loop from integrate() on, written out per lane with no inner loops so the
+    // compiler can run the lanes side by side
+    void KalmanBatch::propagate(double ang_vel_ego, double vdot_x_body, double vdot_y_body) {
+        int n = models.size();
+
+        #pragma omp simd
+        for (int k = 0; k < n; k++) {
+            // 1. STATE PROPAGATE (cart_model::integrate)
+            double x_0 = x[0][k] + (x[2][k] + ang_vel_ego*x[1][k])*dt[k];
+            double x_1 = x[1][k] + (x[3][k] - ang_vel_ego*x[0][k])*dt[k];
+            double x_2 = x[2][k] + (x[3][k]*ang_vel_ego - vdot_x_body)*dt[k];
+            double x_3 = x[3][k] + (-x[2][k]*ang_vel_ego - vdot_y_body)*dt[k];
+
+            // 2. COVARIANCE PROPAGATE, P = STM * P * STM^T + dQ, skipping the zero blocks of
+            // STM = [c s c*dt s*dt; -s c -s*dt c*dt; 0 0 c s; 0 0 -s c]
+            double c = cos_w_dt[k], s = sin_w_dt[k];
+            double c_dt = c*dt[k], s_dt = s*dt[k];
+            double p_00 = P[0][k], p_01 = P[1][k], p_02 = P[2][k], p_03 = P[3][k];
+            double p_10 = P[4][k], p_11 = P[5][k], p_12 = P[6][k], p_13 = P[7][k];
+            double p_20 = P[8][k], p_21 = P[9][k], p_22 = P[10][k], p_23 = P[11][k];
+            double p_30 = P[12][k], p_31 = P[13][k], p_32 = P[14][k], p_33 = P[15][k];
+
+            double f_00 = c*p_00 + s*p_10 + c_dt*p_20 + s_dt*p_30;
+            double f_01 = c*p_01 + s*p_11 + c_dt*p_21 + s_dt*p_31;
+            double f_02 = c*p_02 + s*p_12 + c_dt*p_22 + s_dt*p_32;
+            double f_03 = c*p_03 + s*p_13 + c_dt*p_23 + s_dt*p_33;
+            double f_10 = (-s)*p_00 + c*p_10 + (-s_dt)*p_20 + c_dt*p_30;
+            double f_11 = (-s)*p_01 + c*p_11 + (-s_dt)*p_21 + c_dt*p_31;
+            double f_12 = (-s)*p_02 + c*p_12 + (-s_dt)*p_22 + c_dt*p_32;
+            double f_13 = (-s)*p_03 + c*p_13 + (-s_dt)*p_23 + c_dt*p_33;
+            double f_20 = c*p_20 + s*p_30;
+            double f_21 = c*p_21 + s*p_31;
+            double f_22 = c*p_22 + s*p_32;
+            double f_23 = c*p_23 + s*p_33;
+            double f_30 = (-s)*p_20 + c*p_30;
+            double f_31 = (-s)*p_21 + c*p_31;
+            double f_32 = (-s)*p_22 + c*p_32;
+            double f_33 = (-s)*p_23 + c*p_33;
+
+            // dQ = [dQ_2 dQ_1; dQ_1 dQ_0], each block symmetric and stored as (0,0), (0,1), (1,1)
+            p_00 = c*f_00 + s*f_01 + c_dt*f_02 + s_dt*f_03 + dQ_2[0][k];
+            p_01 = (-s)*f_00 + c*f_01 + (-s_dt)*f_02 + c_dt*f_03 + dQ_2[1][k];
+            p_02 = c*f_02 + s*f_03 + dQ_1[0][k];
+            p_03 = (-s)*f_02 + c*f_03 + dQ_1[1][k];
+            p_10 = c*f_10 + s*f_11 + c_dt*f_12 + s_dt*f_13 + dQ_2[1][k];
+            p_11 = (-s)*f_10 + c*f_11 + (-s_dt)*f_12 + c_dt*f_13 + dQ_2[2][k];
+            p_12 = c*f_12 + s*f_13 + dQ_1[1][k];
+            p_13 = (-s)*f_12 + c*f_13 + dQ_1[2][k];
+            p_20 = c*f_20 + s*f_21 + c_dt*f_22 + s_dt*f_23 + dQ_1[0][k];
+            p_21 = (-s)*f_20 + c*f_21 + (-s_dt)*f_22 + c_dt*f_23 + dQ_1[1][k];
+            p_22 = c*f_22 + s*f_23 + dQ_0[0][k];
+            p_23 = (-s)*f_22 + c*f_23 + dQ_0[1][k];
+            p_30 = c*f_30 + s*f_31 + c_dt*f_32 + s_dt*f_33 + dQ_1[1][k];
+            p_31 = (-s)*f_30 + c*f_31 + (-s_dt)*f_32 + c_dt*f_33 + dQ_1[2][k];
+            p_32 = c*f_32 + s*f_33 + dQ_0[1][k];
+            p_33 = (-s)*f_32 + c*f_33 + dQ_0[2][k];
+
+            // 3. STATE UPDATE, x = x + G * (x_tilde - H x) with the gain from the previous step
+            double innovation_0 = x_tilde[0][k] - x_0;
+            double innovation_1 = x_tilde[1][k] - x_1;
+            x[0][k] = x_0 + (G[0][k]*innovation_0 + G[1][k]*innovation_1);
+            x[1][k] = x_1 + (G[2][k]*innovation_0 + G[3][k]*innovation_1);
+            x[2][k] = x_2 + (G[4][k]*innovation_0 + G[5][k]*innovation_1);
+            x[3][k] = x_3 + (G[6][k]*innovation_0 + G[7][k]*innovation_1);
+
+            // 4. GAIN, G = P H^T (H P H^T + R)^-1
+            double S_00 = p_00 + R[0][k], S_01 = p_01 + R[1][k];
+            double S_10 = p_10 + R[2][k], S_11 = p_11 + R[3][k];
+            double inv_det = 1.0 / (S_00*S_11 - S_01*S_10);
+            double S_inv_00 = S_11*inv_det, S_inv_01 = -S_01*inv_det;
+            double S_inv_10 = -S_10*inv_det, S_inv_11 = S_00*inv_det;
+            double g_00 = p_00*S_inv_00 + p_01*S_inv_10;
+            double g_01 = p_00*S_inv_01 + p_01*S_inv_11;
+            double g_10 = p_10*S_inv_00 + p_11*S_inv_10;
+            double g_11 = p_10*S_inv_01 + p_11*S_inv_11;
+            double g_20 = p_20*S_inv_00 + p_21*S_inv_10;
+            double g_21 = p_20*S_inv_01 + p_21*S_inv_11;
+            double g_30 = p_30*S_inv_00 + p_31*S_inv_10;
+            double g_31 = p_30*S_inv_01 + p_31*S_inv_11;
+            G[0][k] = g_00;
+            G[1][k] = g_01;
+            G[2][k] = g_10;
+            G[3][k] = g_11;
+            G[4][k] = g_20;
+            G[5][k] = g_21;
+            G[6][k] = g_30;
+            G[7][k] = g_31;
+
+            // 5. COVARIANCE UPDATE, P = (I - G H) P
+            P[0][k] = (1.0 - g_00)*p_00 + (-g_01)*p_10;
+            P[1][k] = (1.0 - g_00)*p_01 + (-g_01)*p_11;
+            P[2][k] = (1.0 - g_00)*p_02 + (-g_01)*p_12;
+            P[3][k] = (1.0 - g_00)*p_03 + (-g_01)*p_13;
+            P[4][k] = (-g_10)*p_00 + (1.0 - g_11)*p_10;
+            P[5][k] = (-g_10)*p_01 + (1.0 - g_11)*p_11;
+            P[6][k] = (-g_10)*p_02 + (1.0 - g_11)*p_12;
+            P[7][k] = (-g_10)*p_03 + (1.0 - g_11)*p_13;
+            P[8][k] = (-g_20)*p_00 + (-g_21)*p_10 + p_20;
+            P[9][k] = (-g_20)*p_01 + (-g_21)*p_11 + p_21;
+            P[10][k] = (-g_20)*p_02 + (-g_21)*p_12 + p_22;
+            P[11][k] = (-g_20)*p_03 + (-g_21)*p_13 + p_23;
+            P[12][k] = (-g_30)*p_00 + (-g_31)*p_10 + p_30;
+            P[13][k] = (-g_30)*p_01 + (-g_31)*p_11 + p_31;
+            P[14][k] = (-g_30)*p_02 + (-g_31)*p_12 + p_32;
+            P[15][k] = (-g_30)*p_03 + (-g_31)*p_13 + p_33;
+        }
+    }
+
+    void KalmanBatch::scatter() {
+        int n = models.size();
+        for (int k = 0; k < n; k++) {
+            dynamic_gap::cart_model* model = models[k];
+            for (int i = 0; i < 4; i++) {
+                model->x[i] = x[i][k];
+                for (int j = 0; j < 4; j++) {
+                    model->P(i, j) = P[i*4 + j][k];
+                }
+                for (int j = 0; j < 2; j++) {
+                    model->G(i, j) = G[i*2 + j][k];
+                }
+            }
+            model->end_update();
+        }
+    }
+}
@@ -0,0 +1,49 @@
+#include <dynamic_gap/model_history.h>
+#include <algorithm>
+#include <fstream>
+
+namespace dynamic_gap {
+    void ModelHistory::setDepth(int _depth) {
+        depth = std::max(_depth, 0);
+        head = 0;
+        count = 0;
+        data.assign((size_t) depth * STRIDE, 0.0);
+    }
+
+    void ModelHistory::push(double t, const Eigen::Vector4d& x, const Eigen::Vector4d& x_gt,
+                            const Eigen::Matrix<double, 1, 3>& v_ego, const Eigen::Matrix<double, 1, 3>& a_ego) {
+        if (depth == 0) {
+            return;
+        }
+
+        double* rec = &data[(size_t) head * STRIDE];
+        rec[0] = t;
+        for (int i = 0; i < 4; i++) {
+            rec[1 + i] = x[i];
+            rec[5 + i] = x_gt[i];
+        }
+        for (int i = 0; i < 3; i++) {
+            rec[9 + i] = v_ego[i];
+            rec[12 + i] = a_ego[i];
+        }
+
+        head = (head + 1) % depth;
+        count = std::min(count + 1, depth);
+    }
+
+    bool ModelHistory::dump(const std::string& path) const {
+        std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+        if (!out) {
+            return false;
+        }
+
+        out << "t,r_x,r_y,v_x,v_y,r_x_gt,r_y_gt,v_x_gt,v_y_gt,v_ego_x,v_ego_y,v_ego_ang,a_ego_x,a_ego_y,a_ego_ang\n";
+        for (int i = 0; i < count; i++) {
+            const double* rec = record(i);
+            for (int j = 0; j < STRIDE; j++) {
+                out << rec[j] << (j + 1 < STRIDE ? "," : "\n");
+            }
+        }
+        return true;
+    }
+}
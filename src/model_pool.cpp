@@ -0,0 +1,63 @@
+#include <dynamic_gap/model_pool.h>
+#include <ros/ros.h>
+#include <algorithm>
+#include <new>
+
+namespace dynamic_gap {
+    ModelPool::ModelPool(int _chunk_size) : chunk_size(std::max(_chunk_size, 1)), num_live(0) {}
+
+    ModelPool::~ModelPool() {
+        Eigen::aligned_allocator<Slot> allocator;
+        for (Slot* chunk : chunks) {
+            for (int i = 0; i < chunk_size; i++) {
+                if (chunk[i].live) {
+                    reinterpret_cast<dynamic_gap::cart_model*>(&chunk[i].storage)->~cart_model();
+                }
+            }
+            allocator.deallocate(chunk, chunk_size);
+        }
+    }
+
+    void ModelPool::grow() {
+        Eigen::aligned_allocator<Slot> allocator;
+        Slot* chunk = allocator.allocate(chunk_size);
+        chunks.push_back(chunk);
+
+        free_slots.reserve(capacity());
+        // pushed in reverse so slots are handed out in address order
+        for (int i = chunk_size - 1; i >= 0; i--) {
+            chunk[i].live = false;
+            free_slots.push_back(&chunk[i]);
+        }
+    }
+
+    dynamic_gap::cart_model* ModelPool::acquire(std::string side, int index, double init_r, double init_beta, Matrix<double, 1, 3> v_ego) {
+        if (free_slots.empty()) {
+            grow();
+        }
+
+        Slot* slot = free_slots.back();
+        dynamic_gap::cart_model* model = new (&slot->storage) dynamic_gap::cart_model(side, index, init_r, init_beta, v_ego);
+        free_slots.pop_back();
+        slot->live = true;
+        num_live++;
+        return model;
+    }
+
+    void ModelPool::release(dynamic_gap::cart_model* model) {
+        if (model == NULL) {
+            return;
+        }
+
+        Slot* slot = reinterpret_cast<Slot*>(model);
+        if (!slot->live) {
+            ROS_WARN_STREAM("ModelPool: model released twice");
+            return;
+        }
+
+        model->~cart_model();
+        slot->live = false;
+        free_slots.push_back(slot);
+        num_live--;
+    }
+}
@@ -15,7 +15,11 @@ namespace dynamic_gap
         ros::NodeHandle nh("planner_node");
     }
 
-    Planner::~Planner() {}
+    Planner::~Planner() {
+        if (StageTracer::enabled() && !cfg.tracing.dump_file.empty()) {
+            StageTracer::get().dump(cfg.tracing.dump_file);
+        }
+    }
 
     bool Planner::initialize(const ros::NodeHandle& unh)
     {
@@ -33,6 +37,9 @@ namespace dynamic_gap
         local_traj_pub = nh.advertise<geometry_msgs::PoseArray>("relevant_traj", 1);
         trajectory_pub = nh.advertise<geometry_msgs::PoseArray>("pg_traj", 1);
         dyn_egocircle_pub = nh.advertise<sensor_msgs::LaserScan>("dyn_egocircle", 1);
+        stage_latency_pub = nh.advertise<diagnostic_msgs::DiagnosticArray>("stage_latency", 1);
+
+        StageTracer::get().setEnabled(cfg.tracing.stage_tracing);
 
         rbt_accel_sub = nh.subscribe(cfg.robot_frame_id + "/acc", 1, &Planner::robotAccCB, this);
 
@@ -70,6 +77,7 @@ namespace dynamic_gap
         init_val = 0;
         model_idx = &init_val;
         prev_traj_switch_time = ros::WallTime::now().toSec();
+        prev_trace_pub_time = ros::WallTime::now().toSec();
         init_time = ros::WallTime::now().toSec(); 
 
         curr_right_model = NULL;
@@ -163,6 +171,7 @@ namespace dynamic_gap
     // running at point_scan rate which is around 8-9 Hz
     void Planner::laserScanCB(boost::shared_ptr<sensor_msgs::LaserScan const> msg)
     {
+        // only guards perception state, planning works off of the published snapshot and never waits here
         boost::mutex::scoped_lock gapset(gapset_mutex); // this is where time lag happens (~0.1 to 0.2 seconds)
         curr_timestamp = msg.get()->header.stamp;
         // ROS_INFO_STREAM("laserscanCB time stamp difference: " << (curr_timestamp - prev_timestamp).toSec());
@@ -185,26 +194,25 @@ namespace dynamic_gap
         // ROS_INFO_STREAM("RAW GAP ASSOCIATING");
         // ROS_INFO_STREAM("Time elapsed before raw gaps processing: " << (ros::WallTime::now().toSec() - start_time));
 
+        // one view per received scan, shared by const reference from here on
+        ScanView scan_view(msg, scan_index_pool);
+
         previous_raw_gaps = associated_raw_gaps;
-        raw_gaps = finder->hybridScanGap(msg, final_goal_rbt);
+        previous_gaps = associated_observed_gaps;
+        // merging only reads gap geometry, so both gap sets are found (detection, then merging) before any association
+        finder->findGaps(scan_view, final_goal_rbt, raw_gaps, observed_gaps);
         // ROS_INFO_STREAM("post hybridScanGap, raw_gaps size: " << raw_gaps.size());
         // associated_raw_gaps = raw_gaps;
         
-        raw_distMatrix = gapassociator->obtainDistMatrix(raw_gaps, previous_raw_gaps, "raw");
-        raw_association = gapassociator->associateGaps(raw_distMatrix);         // ASSOCIATE GAPS PASSES BY REFERENCE
-        gapassociator->assignModels(raw_association, raw_distMatrix, raw_gaps, previous_raw_gaps, v_ego, model_idx);
+        dynamic_gap::associateGapSet(*gapassociator, raw_gaps, previous_raw_gaps, "raw", raw_distMatrix, raw_association, v_ego, model_idx);
         associated_raw_gaps = update_models(raw_gaps, v_ego, a_ego, false);
         // ROS_INFO_STREAM("Time elapsed after raw gaps processing: " << (ros::WallTime::now().toSec() - start_time));
 
 
         // double observed_gaps_start_time = ros::WallTime::now().toSec();
-        previous_gaps = associated_observed_gaps;
-        observed_gaps = finder->mergeGapsOneGo(msg, raw_gaps);
         // associated_observed_gaps = observed_gaps;
         
-        simp_distMatrix = gapassociator->obtainDistMatrix(observed_gaps, previous_gaps, "simplified"); // finishes
-        simp_association = gapassociator->associateGaps(simp_distMatrix); // must finish this and therefore change the association
-        gapassociator->assignModels(simp_association, simp_distMatrix, observed_gaps, previous_gaps, v_ego, model_idx);
+        dynamic_gap::associateGapSet(*gapassociator, observed_gaps, previous_gaps, "simplified", simp_distMatrix, simp_association, v_ego, model_idx);
         associated_observed_gaps = update_models(observed_gaps, v_ego, a_ego, false);
         // ROS_INFO_STREAM("Time elapsed after observed gaps processing: " << (ros::WallTime::now().toSec() - start_time));
 
@@ -215,32 +223,35 @@ namespace dynamic_gap
         gapvisualizer->drawGapsModels(associated_observed_gaps);
 
 
-        boost::shared_ptr<sensor_msgs::LaserScan const> tmp;
-        if (sharedPtr_inflatedlaser) {
-            tmp = sharedPtr_inflatedlaser;
-        } else {
-            tmp = msg;
-        }
-
         geometry_msgs::PoseStamped local_goal;
         {
-            goalselector->updateEgoCircle(tmp);
+            if (sharedPtr_inflatedlaser && sharedPtr_inflatedlaser != msg) {
+                goalselector->updateEgoCircle(ScanView(sharedPtr_inflatedlaser, scan_index_pool));
+            } else {
+                goalselector->updateEgoCircle(scan_view);
+            }
             goalselector->updateLocalGoal(map2rbt);
             local_goal = goalselector->getCurrentLocalGoal(rbt2odom);
             goalvisualizer->localGoal(local_goal);
         }
         // ROS_INFO_STREAM("Time elapsed after updating goal selector: " << (ros::WallTime::now().toSec() - start_time));
 
-        trajArbiter->updateEgoCircle(msg);
         trajArbiter->updateLocalGoal(local_goal, odom2rbt);
 
         // ROS_INFO_STREAM("Time elapsed after updating arbiter: " << (ros::WallTime::now().toSec() - start_time));
 
-        gapManip->updateEgoCircle(msg);
-        trajController->updateEgoCircle(msg);
-        gapFeasibilityChecker->updateEgoCircle(msg);
+        trajController->updateEgoCircle(scan_view);
         // ROS_INFO_STREAM("Time elapsed after updating rest: " << (ros::WallTime::now().toSec() - start_time));
 
+        // publish this cycle's gap set. The snapshot is built off to the side and swapped in, so a planning
+        // cycle that is already running keeps the one it loaded. Planning subsystems (feasibility, manipulation,
+        // scoring) take their egocircle from the snapshot in getPlanTrajectory.
+        dynamic_gap::GapSetSnapshotConstPtr snapshot(new dynamic_gap::GapSetSnapshot(associated_raw_gaps, associated_observed_gaps,
+                                                                                     raw_association, simp_association,
+                                                                                     scan_view, goalselector->rbtFrameLocalGoal(),
+                                                                                     curr_timestamp));
+        boost::atomic_store(&gapset_snapshot, snapshot);
+
 
         rbt_vel_min1 = current_rbt_vel;
         rbt_accel_min1 = rbt_accel;
@@ -249,45 +260,16 @@ namespace dynamic_gap
         // ROS_INFO_STREAM("laserscan time elapsed: " << ros::WallTime::now().toSec() - start_time);
     }
     
-    void Planner::update_model(int i, std::vector<dynamic_gap::Gap>& _observed_gaps, Matrix<double, 1, 3> _v_ego, Matrix<double, 1, 3> _a_ego, bool print) {
+    // step by step, with the filter's own logging. Batched updates go through dynamic_gap::updateGapModels
+    void Planner::update_model(int i, std::vector<dynamic_gap::Gap>& _observed_gaps, Matrix<double, 1, 3> _v_ego, Matrix<double, 1, 3> _a_ego) {
         // boost::mutex::scoped_lock gapset(gapset_mutex);
 		dynamic_gap::Gap g = _observed_gaps[int(std::floor(i / 2.0))];
  
         // UPDATING MODELS
-        //std::cout << "obtaining gap g" << std::endl;
-		geometry_msgs::Vector3Stamped gap_pt_vector_rbt_frame;
-        geometry_msgs::Vector3Stamped range_vector_rbt_frame;
-        gap_pt_vector_rbt_frame.header.frame_id = cfg.robot_frame_id;
-        //std::cout << "obtaining gap pt vector" << std::endl;
-		// THIS VECTOR IS IN THE ROBOT FRAME
-		if (i % 2 == 0) {
-			gap_pt_vector_rbt_frame.vector.x = g.RDist() * cos(-((float) g.half_scan - g.RIdx()) / g.half_scan * M_PI);
-			gap_pt_vector_rbt_frame.vector.y = g.RDist() * sin(-((float) g.half_scan - g.RIdx()) / g.half_scan * M_PI);
-		} else {
-			gap_pt_vector_rbt_frame.vector.x = g.LDist() * cos(-((float) g.half_scan - g.LIdx()) / g.half_scan * M_PI);
-			gap_pt_vector_rbt_frame.vector.y = g.LDist() * sin(-((float) g.half_scan - g.LIdx()) / g.half_scan * M_PI);
-		}
-
-        range_vector_rbt_frame.vector.x = gap_pt_vector_rbt_frame.vector.x - rbt_in_cam.pose.position.x;
-        range_vector_rbt_frame.vector.y = gap_pt_vector_rbt_frame.vector.y - rbt_in_cam.pose.position.y;
-        //std::cout << "gap_pt_vector_rbt_frame: " << gap_pt_vector_rbt_frame.vector.x << ", " << gap_pt_vector_rbt_frame.vector.y << std::endl;
-		
-        // pretty sure rbt in cam is always 0,0
-        //std::cout << "rbt in cam pose: " << rbt_in_cam.pose.position.x << ", " << rbt_in_cam.pose.position.x << std::endl;
-        //std::cout << "range vector rbt frame: " << range_vector_rbt_frame.vector.x << ", " << range_vector_rbt_frame.vector.x << std::endl;
-
-        double beta_tilde = std::atan2(range_vector_rbt_frame.vector.y, range_vector_rbt_frame.vector.x);
-		double range_tilde = std::sqrt(std::pow(range_vector_rbt_frame.vector.x, 2) + pow(range_vector_rbt_frame.vector.y, 2));
-		
-		Matrix<double, 2, 1> laserscan_measurement(range_tilde, beta_tilde);
-
-        if (i % 2 == 0) {
-            //std::cout << "entering left model update" << std::endl;
-            g.right_model->kf_update_loop(laserscan_measurement, _a_ego, _v_ego, print, agent_odom_vects, agent_vel_vects);
-        } else {
-            //std::cout << "entering right model update" << std::endl;
-            g.left_model->kf_update_loop(laserscan_measurement, _a_ego, _v_ego, print, agent_odom_vects, agent_vel_vects);
-        }
+		Matrix<double, 2, 1> laserscan_measurement = dynamic_gap::gapEndpointMeasurement(g, i % 2 == 0, rbt_in_cam);
+
+        dynamic_gap::cart_model* model = (i % 2 == 0) ? g.right_model : g.left_model;
+        model->kf_update_loop(laserscan_measurement, _a_ego, _v_ego, true, agent_odom_vects, agent_vel_vects);
     }
 
     // TO CHECK: DOES ASSOCIATIONS KEEP OBSERVED GAP POINTS IN ORDER (0,1,2,3...)
@@ -295,11 +277,15 @@ namespace dynamic_gap
         std::vector<dynamic_gap::Gap> associated_observed_gaps = _observed_gaps;
         
         // double start_time = ros::WallTime::now().toSec();
-        for (int i = 0; i < 2*associated_observed_gaps.size(); i++) {
-            //std::cout << "update gap model: " << i << std::endl;
-            update_model(i, associated_observed_gaps, _v_ego, _a_ego, print);
-            //std::cout << "" << std::endl;
-		}
+        if (print) {
+            ScopedStageTimer trace(TRACE_UPDATE_MODELS);
+            for (int i = 0; i < 2*associated_observed_gaps.size(); i++) {
+                update_model(i, associated_observed_gaps, _v_ego, _a_ego);
+            }
+        } else {
+            dynamic_gap::updateGapModels(associated_observed_gaps, rbt_in_cam, kf_batch, _a_ego, _v_ego,
+                                         agent_odom_vects, agent_vel_vects, ros::Time::now().toSec());
+        }
 
         //ROS_INFO_STREAM("update_models time elapsed: " << ros::WallTime::now().toSec() - start_time);
         return associated_observed_gaps;
@@ -467,105 +453,50 @@ namespace dynamic_gap
         }
     }
 
-    std::vector<dynamic_gap::Gap> Planner::gapManipulate(std::vector<dynamic_gap::Gap> _observed_gaps) {
-        boost::mutex::scoped_lock gapset(gapset_mutex);
+    std::vector<dynamic_gap::Gap> Planner::gapManipulate(std::vector<dynamic_gap::Gap> _observed_gaps, const dynamic_gap::GapSetSnapshot& snapshot) {
         std::vector<dynamic_gap::Gap> manip_set = _observed_gaps;
-        std::vector<dynamic_gap::Gap> curr_raw_gaps = associated_raw_gaps;
-
         // we want to change the models in here
-
-        for (size_t i = 0; i < manip_set.size(); i++)
-        {
-            ROS_INFO_STREAM("MANIPULATING INITIAL GAP " << i);
-            // MANIPULATE POINTS AT T=0
-            manip_set.at(i).initManipIndices();
-            
-            gapManip->reduceGap(manip_set.at(i), goalselector->rbtFrameLocalGoal(), true); // cut down from non convex 
-            gapManip->convertAxialGap(manip_set.at(i), true); // swing axial inwards
-            gapManip->inflateGapSides(manip_set.at(i), true); // inflate gap radially
-            gapManip->radialExtendGap(manip_set.at(i), true); // extend behind robot
-            gapManip->setGapWaypoint(manip_set.at(i), goalselector->rbtFrameLocalGoal(), true); // incorporating dynamic gap types
-            
-            // MANIPULATE POINTS AT T=1
-            ROS_INFO_STREAM("MANIPULATING TERMINAL GAP " << i);
-            gapManip->updateDynamicEgoCircle(curr_raw_gaps, manip_set.at(i), agent_odom_vects, agent_vel_vects, trajArbiter);
-            if (!manip_set.at(i).gap_crossed && !manip_set.at(i).gap_closed) {
-                gapManip->reduceGap(manip_set.at(i), goalselector->rbtFrameLocalGoal(), false); // cut down from non convex 
-                gapManip->convertAxialGap(manip_set.at(i), false); // swing axial inwards
-            }
-            gapManip->inflateGapSides(manip_set.at(i), false); // inflate gap radially
-            gapManip->radialExtendGap(manip_set.at(i), false); // extend behind robot
-            gapManip->setTerminalGapWaypoint(manip_set.at(i), goalselector->rbtFrameLocalGoal()); // incorporating dynamic gap type
-            
-        }
-
+        dynamic_gap::manipulateGaps(*gapManip, *trajArbiter, manip_set, snapshot.local_goal, agent_odom_vects, agent_vel_vects);
         return manip_set;
     }
 
     // std::vector<geometry_msgs::PoseArray> 
-    std::vector<std::vector<double>> Planner::initialTrajGen(std::vector<dynamic_gap::Gap>& vec, std::vector<geometry_msgs::PoseArray>& res, std::vector<std::vector<double>>& res_time_traj) {
-        boost::mutex::scoped_lock gapset(gapset_mutex);
-        std::vector<geometry_msgs::PoseArray> ret_traj(vec.size());
-        std::vector<std::vector<double>> ret_time_traj(vec.size());
+    std::vector<std::vector<double>> Planner::initialTrajGen(std::vector<dynamic_gap::Gap>& vec, std::vector<dynamic_gap::Trajectory2D>& res, const dynamic_gap::GapSetSnapshot& snapshot) {
+        std::vector<dynamic_gap::Trajectory2D> ret_traj(vec.size());
         std::vector<std::vector<double>> ret_traj_scores(vec.size());
         geometry_msgs::PoseStamped rbt_in_cam_lc = rbt_in_cam; // lc as local copy
+        geometry_msgs::TransformStamped cam2odom_lc = cam2odom;
+        geometry_msgs::Twist rbt_vel_lc = current_rbt_vel;
+
+        // agent callbacks can land mid-cycle, so work off of a copy
+        std::vector<std::vector<double>> curr_agent_odom_vects = agent_odom_vects;
+        std::vector<std::vector<double>> curr_agent_vel_vects = agent_vel_vects;
+
+        std::vector<std::tuple<geometry_msgs::PoseArray, std::vector<double>>> rbt_trajs;
+        dynamic_gap::generateGapTrajectories(*gapTrajSyn, *trajArbiter, vec, rbt_in_cam_lc, rbt_vel_lc, snapshot.raw_gaps,
+                                             curr_agent_odom_vects, curr_agent_vel_vects, cfg.planning.parallel_traj_gen,
+                                             rbt_trajs, ret_traj_scores);
 
-        std::vector<dynamic_gap::Gap> curr_raw_gaps = associated_raw_gaps;
         try {
             for (size_t i = 0; i < vec.size(); i++) {
-                ROS_INFO_STREAM("generating traj for gap: " << i);
-                // std::cout << "starting generate trajectory with rbt_in_cam_lc: " << rbt_in_cam_lc.pose.position.x << ", " << rbt_in_cam_lc.pose.position.y << std::endl;
-                // std::cout << "goal of: " << vec.at(i).goal.x << ", " << vec.at(i).goal.y << std::endl;
-                std::tuple<geometry_msgs::PoseArray, std::vector<double>> return_tuple;
-                
-                // TRAJECTORY GENERATED IN RBT FRAME
-                bool run_g2g = (vec.at(i).goal.goalwithin || vec.at(i).artificial);
-                if (run_g2g) {
-                    ROS_INFO_STREAM("running g2g and ahpf");
-                    std::tuple<geometry_msgs::PoseArray, std::vector<double>> g2g_tuple;
-                    g2g_tuple = gapTrajSyn->generateTrajectory(vec.at(i), rbt_in_cam_lc, current_rbt_vel, run_g2g);
-                    g2g_tuple = gapTrajSyn->forwardPassTrajectory(g2g_tuple);
-                    std::vector<double> g2g_score_vec = trajArbiter->scoreTrajectory(std::get<0>(g2g_tuple), std::get<1>(g2g_tuple), curr_raw_gaps, 
-                                                                                     agent_odom_vects, agent_vel_vects, false, false);
-                    double g2g_score = std::accumulate(g2g_score_vec.begin(), g2g_score_vec.end(), double(0));
-                    ROS_INFO_STREAM("g2g_score: " << g2g_score);
-
-                    std::tuple<geometry_msgs::PoseArray, std::vector<double>> ahpf_tuple;
-                    ahpf_tuple = gapTrajSyn->generateTrajectory(vec.at(i), rbt_in_cam_lc, current_rbt_vel, !run_g2g);
-                    ahpf_tuple = gapTrajSyn->forwardPassTrajectory(ahpf_tuple);
-                    std::vector<double> ahpf_score_vec = trajArbiter->scoreTrajectory(std::get<0>(ahpf_tuple), std::get<1>(ahpf_tuple), curr_raw_gaps, 
-                                                                                        agent_odom_vects, agent_vel_vects, false, false);
-                    double ahpf_score = std::accumulate(ahpf_score_vec.begin(), ahpf_score_vec.end(), double(0));
-                    ROS_INFO_STREAM("ahpf_score: " << ahpf_score);
-
-                    return_tuple = (g2g_score > ahpf_score) ? g2g_tuple : ahpf_tuple;
-                    ret_traj_scores.at(i) = (g2g_score > ahpf_score) ? g2g_score_vec : ahpf_score_vec;
-                } else {
-                    return_tuple = gapTrajSyn->generateTrajectory(vec.at(i), rbt_in_cam_lc, current_rbt_vel, run_g2g);
-                    return_tuple = gapTrajSyn->forwardPassTrajectory(return_tuple);
-
-                    ROS_INFO_STREAM("scoring trajectory for gap: " << i);
-                    ret_traj_scores.at(i) = trajArbiter->scoreTrajectory(std::get<0>(return_tuple), std::get<1>(return_tuple), curr_raw_gaps, 
-                                                                         agent_odom_vects, agent_vel_vects, false, false);
-                }
-
-                // TRAJECTORY TRANSFORMED BACK TO ODOM FRAME
-                ret_traj.at(i) = gapTrajSyn->transformBackTrajectory(std::get<0>(return_tuple), cam2odom);
-                ret_time_traj.at(i) = std::get<1>(return_tuple);
+                // TRAJECTORY ATTACHED TO ODOM FRAME, poses are only transformed when materialized
+                ret_traj.at(i) = dynamic_gap::Trajectory2D(std::get<0>(rbt_trajs.at(i)), std::get<1>(rbt_trajs.at(i))).transformed(cam2odom_lc);
             }
-
         } catch (...) {
             ROS_FATAL_STREAM("initialTrajGen");
         }
 
-        trajvisualizer->pubAllScore(ret_traj, ret_traj_scores);
-        trajvisualizer->pubAllTraj(ret_traj);
+        std::vector<geometry_msgs::PoseArray> viz_traj(ret_traj.size());
+        for (size_t i = 0; i < ret_traj.size(); i++) {
+            viz_traj.at(i) = ret_traj.at(i).toPoseArray();
+        }
+        trajvisualizer->pubAllScore(viz_traj, ret_traj_scores);
+        trajvisualizer->pubAllTraj(viz_traj);
         res = ret_traj;
-        res_time_traj = ret_time_traj;
         return ret_traj_scores;
     }
 
-    int Planner::pickTraj(std::vector<geometry_msgs::PoseArray> prr, std::vector<std::vector<double>> score) {
+    int Planner::pickTraj(const std::vector<dynamic_gap::Trajectory2D>& prr, std::vector<std::vector<double>> score) {
         // ROS_INFO_STREAM_NAMED("pg_trajCount", "pg_trajCount, " << prr.size());
         if (prr.size() == 0) {
             ROS_WARN_STREAM("No traj synthesized");
@@ -587,8 +518,8 @@ namespace dynamic_gap
                 counts = std::min(cfg.planning.num_feasi_check, int(score.at(i).size()));
 
                 result_score.at(i) = std::accumulate(score.at(i).begin(), score.at(i).begin() + counts, double(0));
-                result_score.at(i) = prr.at(i).poses.size() == 0 ? -std::numeric_limits<double>::infinity() : result_score.at(i);
-                ROS_INFO_STREAM("for gap " << i << " (length: " << prr.at(i).poses.size() << "), returning score of " << result_score.at(i));
+                result_score.at(i) = prr.at(i).empty() ? -std::numeric_limits<double>::infinity() : result_score.at(i);
+                ROS_INFO_STREAM("for gap " << i << " (length: " << prr.at(i).size() << "), returning score of " << result_score.at(i));
                 /*
                 if (result_score.at(i) == -std::numeric_limits<double>::infinity()) {
                     for (size_t j = 0; j < counts; j++) {
@@ -621,12 +552,12 @@ namespace dynamic_gap
         return idx;
     }
 
-    geometry_msgs::PoseArray Planner::compareToOldTraj(geometry_msgs::PoseArray incoming, dynamic_gap::Gap incoming_gap, std::vector<dynamic_gap::Gap> feasible_gaps, std::vector<double> time_arr) {
-        boost::mutex::scoped_lock gapset(gapset_mutex);
+    geometry_msgs::PoseArray Planner::compareToOldTraj(dynamic_gap::Trajectory2D incoming, dynamic_gap::Gap incoming_gap, std::vector<dynamic_gap::Gap> feasible_gaps, const std::vector<double>& incom_score, const dynamic_gap::GapSetSnapshot& snapshot) {
+        ScopedStageTimer trace(TRACE_COMPARE_TO_OLD_TRAJ);
         auto curr_traj = getCurrentTraj();
-        auto curr_time_arr = getCurrentTimeArr();
+        const std::vector<double>& curr_time_arr = curr_traj.times();
 
-        std::vector<dynamic_gap::Gap> curr_raw_gaps = associated_raw_gaps;
+        std::vector<dynamic_gap::Gap> curr_raw_gaps = snapshot.raw_gaps;
 
         try {
             double curr_time = ros::WallTime::now().toSec();
@@ -650,22 +581,19 @@ namespace dynamic_gap
             //std::cout << "incoming time length: " << time_arr.size() << std::endl;
             
             // Both Args are in Odom frame
-            auto incom_rbt = gapTrajSyn->transformBackTrajectory(incoming, odom2rbt);
-            incom_rbt.header.frame_id = cfg.robot_frame_id;
-            // why do we have to rescore here?
-            ROS_INFO_STREAM("~~~~scoring incoming trajectory~~~~");
-            auto incom_score = trajArbiter->scoreTrajectory(incom_rbt, time_arr, curr_raw_gaps, 
-                                                            agent_odom_vects, agent_vel_vects, false, true);
+            // poseCB can update odom2rbt at any time, use one copy for the whole comparison
+            geometry_msgs::TransformStamped odom2rbt_lc = odom2rbt;
+            // incoming was scored against this snapshot in initialTrajGen, no need to score it again
             // int counts = std::min(cfg.planning.num_feasi_check, (int) std::min(incom_score.size(), curr_score.size()));
 
             int counts = std::min(cfg.planning.num_feasi_check, (int) incom_score.size());
             auto incom_subscore = std::accumulate(incom_score.begin(), incom_score.begin() + counts, double(0));
 
             ROS_INFO_STREAM("subscore: " << incom_subscore);
-            bool curr_traj_length_zero = curr_traj.poses.size() == 0;
+            bool curr_traj_length_zero = curr_traj.empty();
             bool curr_gap_not_feasible = !curr_gap_feasible;
             if (curr_traj_length_zero || curr_gap_not_feasible) {
-                if (incoming.poses.size() > 0 && incom_subscore != -std::numeric_limits<double>::infinity()) {
+                if (!incoming.empty() && incom_subscore != -std::numeric_limits<double>::infinity()) {
                     
                     if (curr_traj_length_zero) {
                         ROS_INFO_STREAM("TRAJECTORY CHANGE TO INCOMING: curr traj length 0, incoming score finite");        
@@ -673,58 +601,57 @@ namespace dynamic_gap
                         ROS_INFO_STREAM("TRAJECTORY CHANGE TO INCOMING: curr gap no longer feasible, incoming score finite");        
                     }
                     setCurrentTraj(incoming);
-                    setCurrentTimeArr(time_arr);
                     setCurrentRightModel(incoming_gap.right_model);
                     setCurrentLeftModel(incoming_gap.left_model);
                     setCurrentGapPeakVelocities(incoming_gap.peak_velocity_x, incoming_gap.peak_velocity_y);
-                    trajectory_pub.publish(incoming);
+                    geometry_msgs::PoseArray incoming_odom = incoming.toPoseArray();
+                    trajectory_pub.publish(incoming_odom);
                     ROS_WARN_STREAM("Old Traj length 0");
                     prev_traj_switch_time = curr_time;
-                    return incoming;
+                    return incoming_odom;
                 } else  {
                     if (curr_traj_length_zero) {
                         ROS_INFO_STREAM("TRAJECTORY CHANGE TO EMPTY: curr traj length 0, incoming traj length 0");        
                     } else {
                         ROS_INFO_STREAM("TRAJECTORY CHANGE TO EMPTY: curr gap no longer feasible, incoming traj length 0");        
                     }
-                    auto empty_traj = geometry_msgs::PoseArray();
-                    std::vector<double> empty_time_arr;
-                    setCurrentTraj(empty_traj);
-                    setCurrentTimeArr(empty_time_arr);
+                    setCurrentTraj(dynamic_gap::Trajectory2D());
                     // setCurrentLeftModel(NULL);
                     // setCurrentRightModel(NULL);
-                    return empty_traj;
+                    return geometry_msgs::PoseArray();
                 }
             } 
 
-            auto curr_rbt = gapTrajSyn->transformBackTrajectory(curr_traj, odom2rbt);
+            auto curr_rbt = curr_traj.transformed(odom2rbt_lc).toPoseArray();
             curr_rbt.header.frame_id = cfg.robot_frame_id;
             int start_position = egoTrajPosition(curr_rbt);
             geometry_msgs::PoseArray reduced_curr_rbt = curr_rbt;
-            std::vector<double> reduced_curr_time_arr = curr_time_arr;
             reduced_curr_rbt.poses = std::vector<geometry_msgs::Pose>(curr_rbt.poses.begin() + start_position, curr_rbt.poses.end());
-            reduced_curr_time_arr = std::vector<double>(curr_time_arr.begin() + start_position, curr_time_arr.end());
+            std::vector<double> reduced_curr_time_arr(curr_time_arr.begin() + start_position, curr_time_arr.end());
             if (reduced_curr_rbt.poses.size() < 2) {
                 ROS_INFO_STREAM("TRAJECTORY CHANGE TO INCOMING: old traj length less than 2");
                 ROS_WARN_STREAM("Old Traj short");
                 setCurrentTraj(incoming);
-                setCurrentTimeArr(time_arr);
                 setCurrentRightModel(incoming_gap.right_model);
                 setCurrentLeftModel(incoming_gap.left_model);
                 setCurrentGapPeakVelocities(incoming_gap.peak_velocity_x, incoming_gap.peak_velocity_y);
                 prev_traj_switch_time = curr_time;
-                return incoming;
+                return incoming.toPoseArray();
             }
 
-            counts = std::min(cfg.planning.num_feasi_check, (int) std::min(incoming.poses.size(), reduced_curr_rbt.poses.size()));
+            counts = std::min(cfg.planning.num_feasi_check, (int) std::min((size_t) incoming.size(), reduced_curr_rbt.poses.size()));
             // std::cout << "counts: " << counts << std::endl;
-            ROS_INFO_STREAM("~~~~re-scoring incoming trajectory~~~~");
+            // The two scores are not taken in the same frame: incoming keeps the scores initialTrajGen gave it in
+            // the robot frame it was generated in, while the current trajectory is scored below in the robot frame
+            // of odom2rbt_lc, i.e. from where the robot is now
             incom_subscore = std::accumulate(incom_score.begin(), incom_score.begin() + counts, double(0));
-            ROS_INFO_STREAM("subscore: " << incom_subscore);
+            ROS_INFO_STREAM("incoming subscore: " << incom_subscore);
 
             ROS_INFO_STREAM("~~~~scoring current trajectory~~~~~");
-            auto curr_score = trajArbiter->scoreTrajectory(reduced_curr_rbt, reduced_curr_time_arr, curr_raw_gaps, 
-                                                           agent_odom_vects, agent_vel_vects, false, false);
+            trajArbiter->freezeRawModels(curr_raw_gaps);
+            std::vector<double> curr_pose_costs = trajArbiter->scorePoses(reduced_curr_rbt, reduced_curr_time_arr, curr_raw_gaps, 
+                                                                          agent_odom_vects, agent_vel_vects, false);
+            auto curr_score = trajArbiter->applyTerminalCost(reduced_curr_rbt, curr_pose_costs);
             auto curr_subscore = std::accumulate(curr_score.begin(), curr_score.begin() + counts, double(0));
             ROS_INFO_STREAM("subscore: " << curr_subscore);
 
@@ -732,21 +659,19 @@ namespace dynamic_gap
             ret_traj_scores.at(0) = incom_score;
             ret_traj_scores.at(1) = curr_score;
             std::vector<geometry_msgs::PoseArray> viz_traj(2);
-            viz_traj.at(0) = incom_rbt;
+            viz_traj.at(0) = incoming.transformed(odom2rbt_lc).toPoseArray();
+            viz_traj.at(0).header.frame_id = cfg.robot_frame_id;
             viz_traj.at(1) = reduced_curr_rbt;
             trajvisualizer->pubAllScore(viz_traj, ret_traj_scores);
 
             if (curr_subscore == -std::numeric_limits<double>::infinity() && incom_subscore == -std::numeric_limits<double>::infinity()) {
                 ROS_INFO_STREAM("TRAJECTORY CHANGE TO EMPTY: both -infinity");
                 ROS_WARN_STREAM("Both Failed");
-                auto empty_traj = geometry_msgs::PoseArray();
-                std::vector<double> empty_time_arr;
-                setCurrentTraj(empty_traj);
-                setCurrentTimeArr(empty_time_arr);
+                setCurrentTraj(dynamic_gap::Trajectory2D());
                 // setCurrentLeftModel(NULL);
                 // setCurrentRightModel(NULL);
 
-                return empty_traj;
+                return geometry_msgs::PoseArray();
             }
 
             // commenting this out to prevent switching. Only re-plan when done or collision
@@ -758,21 +683,23 @@ namespace dynamic_gap
                 ROS_INFO_STREAM("TRAJECTORY CHANGE TO INCOMING: swapping trajectory due to collision");
                 ROS_WARN_STREAM("Swap to new for better score: " << incom_subscore << " > " << curr_subscore << " + " << oscillation_pen);
                 setCurrentTraj(incoming);
-                setCurrentTimeArr(time_arr);
                 setCurrentRightModel(incoming_gap.right_model);
                 setCurrentLeftModel(incoming_gap.left_model);
                 setCurrentGapPeakVelocities(incoming_gap.peak_velocity_x, incoming_gap.peak_velocity_y);
-                trajectory_pub.publish(incoming);
+                geometry_msgs::PoseArray incoming_odom = incoming.toPoseArray();
+                trajectory_pub.publish(incoming_odom);
                 prev_traj_switch_time = curr_time;
-                return incoming;
+                return incoming_odom;
             }
             ROS_INFO_STREAM("keeping current trajectory");
 
-            trajectory_pub.publish(curr_traj);
+            geometry_msgs::PoseArray curr_odom = curr_traj.toPoseArray();
+            trajectory_pub.publish(curr_odom);
+            return curr_odom;
         } catch (...) {
             ROS_FATAL_STREAM("compareToOldTraj");
         }
-        return curr_traj;
+        return curr_traj.toPoseArray();
     }
 
     int Planner::egoTrajPosition(geometry_msgs::PoseArray curr) {
@@ -825,28 +752,19 @@ namespace dynamic_gap
         }    
     }
 
-    void Planner::setCurrentTraj(geometry_msgs::PoseArray curr_traj) {
+    void Planner::setCurrentTraj(dynamic_gap::Trajectory2D curr_traj) {
         curr_executing_traj = curr_traj;
         return;
     }
 
-    geometry_msgs::PoseArray Planner::getCurrentTraj() {
+    dynamic_gap::Trajectory2D Planner::getCurrentTraj() {
         return curr_executing_traj;
     }
 
-    void Planner::setCurrentTimeArr(std::vector<double> curr_time_arr) {
-        curr_executing_time_arr = curr_time_arr;
-        return;
-    }
-    
-    std::vector<double> Planner::getCurrentTimeArr() {
-        return curr_executing_time_arr;
-    }
-
     void Planner::reset()
     {
         observed_gaps.clear();
-        setCurrentTraj(geometry_msgs::PoseArray());
+        setCurrentTraj(dynamic_gap::Trajectory2D());
         rbt_accel = geometry_msgs::Twist();
         ROS_INFO_STREAM("log_vel_comp size: " << log_vel_comp.size());
         log_vel_comp.clear();
@@ -864,12 +782,10 @@ namespace dynamic_gap
     }
 
     geometry_msgs::Twist Planner::ctrlGeneration(geometry_msgs::PoseArray traj) {
-        sensor_msgs::LaserScan stored_scan_msgs;
-        if (cfg.planning.projection_inflated) {
-            stored_scan_msgs = *sharedPtr_inflatedlaser.get();
-        } else {
-            stored_scan_msgs = *sharedPtr_laser.get();
-        }
+        ScopedStageTimer trace(TRACE_CTRL_GENERATION);
+        // hold the pointer so the referenced scan outlives a concurrent laserScanCB
+        boost::shared_ptr<sensor_msgs::LaserScan const> ctrl_scan_ptr = cfg.planning.projection_inflated ? sharedPtr_inflatedlaser : sharedPtr_laser;
+        const sensor_msgs::LaserScan& stored_scan_msgs = *ctrl_scan_ptr;
 
         if (traj.poses.size() < 2) {
             ROS_WARN_STREAM("Available Execution Traj length: " << traj.poses.size() << " < 2");
@@ -913,6 +829,7 @@ namespace dynamic_gap
     void Planner::rcfgCallback(dynamic_gap::dgConfig &config, uint32_t level)
     {
         cfg.reconfigure(config);
+        StageTracer::get().setEnabled(cfg.tracing.stage_tracing);
         
         // set_capacity destroys everything if different from original size, 
         // resize only if the new size is greater
@@ -937,14 +854,10 @@ namespace dynamic_gap
         return simp_association;
     }
 
-    std::vector<dynamic_gap::Gap> Planner::gapSetFeasibilityCheck() {
-        boost::mutex::scoped_lock gapset(gapset_mutex);
+    std::vector<dynamic_gap::Gap> Planner::gapSetFeasibilityCheck(const dynamic_gap::GapSetSnapshot& snapshot) {
         //std::cout << "PULLING MODELS TO ACT ON" << std::endl;
-        std::vector<dynamic_gap::Gap> curr_raw_gaps = associated_raw_gaps;
-        std::vector<dynamic_gap::Gap> curr_observed_gaps = associated_observed_gaps;
-        
-        std::vector<dynamic_gap::Gap> prev_raw_gaps = previous_raw_gaps;
-        std::vector<dynamic_gap::Gap> prev_observed_gaps = previous_gaps;  
+        std::vector<dynamic_gap::Gap> curr_raw_gaps = snapshot.raw_gaps;
+        std::vector<dynamic_gap::Gap> curr_observed_gaps = snapshot.observed_gaps;
 
         //std::vector<int> _raw_association = raw_association;
         //std::vector<int> _simp_association = simp_association;
@@ -971,39 +884,40 @@ namespace dynamic_gap
         ROS_INFO_STREAM("current simplified gaps:");
         printGapModels(curr_observed_gaps);
 
-        bool gap_i_feasible;
-        std::vector<dynamic_gap::Gap> feasible_gap_set;
-        for (size_t i = 0; i < curr_observed_gaps.size(); i++) {
-            // obtain crossing point
-            ROS_INFO_STREAM("feasibility check for gap " << i); //  ", left index: " << manip_set.at(i).left_model->get_index() << ", right index: " << manip_set.at(i).right_model->get_index() 
-            gap_i_feasible = gapFeasibilityChecker->indivGapFeasibilityCheck(curr_observed_gaps.at(i));
-            
-            if (gap_i_feasible) {
-                curr_observed_gaps.at(i).addTerminalRightInformation();
-                feasible_gap_set.push_back(curr_observed_gaps.at(i));
-                // ROS_INFO_STREAM("Pushing back gap with peak velocity of : " << curr_observed_gaps.at(i).peak_velocity_x << ", " << curr_observed_gaps.at(i).peak_velocity_y);
-            }
-        }
-        return feasible_gap_set;
+        return dynamic_gap::feasibleGaps(*gapFeasibilityChecker, curr_observed_gaps);
+    }
+
+    dynamic_gap::GapSetSnapshotConstPtr Planner::getGapSetSnapshot() {
+        return boost::atomic_load(&gapset_snapshot);
     }
 
     geometry_msgs::PoseArray Planner::getPlanTrajectory() {
         double getPlan_start_time = ros::WallTime::now().toSec();
         double start_time = ros::WallTime::now().toSec();      
 
+        publishStageLatency();
+
+        // one gap set for the whole cycle, later scans do not change it underneath us
+        dynamic_gap::GapSetSnapshotConstPtr snapshot = getGapSetSnapshot();
+        if (!snapshot) {
+            ROS_WARN_STREAM("getPlanTrajectory: no gap set received yet");
+            return geometry_msgs::PoseArray();
+        }
+
+        dynamic_gap::updatePlanningEgoCircle(snapshot->scan, *trajArbiter, *gapManip, *gapFeasibilityChecker);
+
         // ROS_INFO_STREAM("starting gapSetFeasibilityCheck");  
-        std::vector<dynamic_gap::Gap> feasible_gap_set = gapSetFeasibilityCheck();
+        std::vector<dynamic_gap::Gap> feasible_gap_set = gapSetFeasibilityCheck(*snapshot);
         int gaps_size = feasible_gap_set.size();
         // ROS_INFO_STREAM("DGap gapSetFeasibilityCheck time taken for " << gaps_size << " gaps: " << (ros::WallTime::now().toSec() - start_time));
 
         // start_time = ros::WallTime::now().toSec();
-        auto manip_gap_set = gapManipulate(feasible_gap_set);
+        auto manip_gap_set = gapManipulate(feasible_gap_set, *snapshot);
         // ROS_INFO_STREAM("DGap gapManipulate time taken for " << gaps_size << " gaps: " << (ros::WallTime::now().toSec() - start_time));
 
         start_time = ros::WallTime::now().toSec();
-        std::vector<geometry_msgs::PoseArray> traj_set;
-        std::vector<std::vector<double>> time_set;
-        auto score_set = initialTrajGen(manip_gap_set, traj_set, time_set);
+        std::vector<dynamic_gap::Trajectory2D> traj_set;
+        auto score_set = initialTrajGen(manip_gap_set, traj_set, *snapshot);
         ROS_INFO_STREAM("DGap initialTrajGen time taken for " << gaps_size << " gaps: " << (ros::WallTime::now().toSec() - start_time));
 
         visualizeComponents(manip_gap_set); // need to run after initialTrajGen to see what weights for reachable gap are
@@ -1015,20 +929,31 @@ namespace dynamic_gap
         // ROS_INFO_STREAM("DGap pickTraj time taken for " << gaps_size << " gaps: " << (ros::WallTime::now().toSec() - start_time));
 
 
-        geometry_msgs::PoseArray chosen_traj;
-        std::vector<double> chosen_time_arr;
+        dynamic_gap::Trajectory2D chosen_traj;
+        std::vector<double> chosen_score;
         dynamic_gap::Gap chosen_gap;
         if (traj_idx >= 0) {
             chosen_traj = traj_set[traj_idx];
-            chosen_time_arr = time_set[traj_idx];
+            chosen_score = score_set[traj_idx];
             chosen_gap = manip_gap_set[traj_idx];
         } else {
-            chosen_traj = geometry_msgs::PoseArray();
+            chosen_traj = dynamic_gap::Trajectory2D();
             chosen_gap = dynamic_gap::Gap();
         }
 
         // start_time = ros::WallTime::now().toSec();
-        auto final_traj = compareToOldTraj(chosen_traj, chosen_gap, feasible_gap_set, chosen_time_arr);
+        auto final_traj = compareToOldTraj(chosen_traj, chosen_gap, feasible_gap_set, chosen_score, *snapshot);
+
+        // the executing gap's models are either from this snapshot (just switched to) or from an older one.
+        // Follow them into this snapshot so the controller sees the latest estimates, and keep whichever
+        // snapshot they end up in alive.
+        dynamic_gap::cart_model* latest_right_model = curr_right_model ? snapshot->findModel(curr_right_model->get_index()) : NULL;
+        dynamic_gap::cart_model* latest_left_model = curr_left_model ? snapshot->findModel(curr_left_model->get_index()) : NULL;
+        if ((curr_right_model == NULL || latest_right_model != NULL) && (curr_left_model == NULL || latest_left_model != NULL)) {
+            curr_right_model = latest_right_model;
+            curr_left_model = latest_left_model;
+            exec_snapshot = snapshot;
+        }
         // ROS_INFO_STREAM("DGap compareToOldTraj time taken for " << gaps_size << " gaps: "  << (ros::WallTime::now().toSec() - start_time));
         
         // ROS_INFO_STREAM("DGap getPlanTrajectory time taken for " << gaps_size << " gaps: "  << (ros::WallTime::now().toSec() - getPlan_start_time));
@@ -1036,8 +961,6 @@ namespace dynamic_gap
     }
 
     void Planner::visualizeComponents(std::vector<dynamic_gap::Gap> manip_gap_set) {
-        boost::mutex::scoped_lock gapset(gapset_mutex);
-
         gapvisualizer->drawManipGaps(manip_gap_set, std::string("manip"));
         gapvisualizer->drawReachableGaps(manip_gap_set);        
         gapvisualizer->drawReachableGapsCenters(manip_gap_set); 
@@ -1046,6 +969,35 @@ namespace dynamic_gap
         goalvisualizer->drawGapGoals(manip_gap_set);
     }
 
+    void Planner::publishStageLatency() {
+        bool tracing = StageTracer::enabled();
+        bool association_stats = cfg.gap_assoc.angular_association;
+        if (!tracing && !association_stats) {
+            return;
+        }
+
+        double curr_time = ros::WallTime::now().toSec();
+        if (curr_time - prev_trace_pub_time < cfg.tracing.publish_period) {
+            return;
+        }
+        prev_trace_pub_time = curr_time;
+
+        diagnostic_msgs::DiagnosticArray diagnostics;
+        if (tracing) {
+            diagnostics = StageTracer::get().toDiagnostics(ros::Time::now());
+        } else {
+            diagnostics.header.stamp = ros::Time::now();
+        }
+        if (association_stats) {
+            diagnostics.status.push_back(gapassociator->associationDiagnostics());
+        }
+        stage_latency_pub.publish(diagnostics);
+
+        if (tracing && !cfg.tracing.dump_file.empty()) {
+            StageTracer::get().dump(cfg.tracing.dump_file);
+        }
+    }
+
     void Planner::printGapAssociations(std::vector<dynamic_gap::Gap> current_gaps, std::vector<dynamic_gap::Gap> previous_gaps, std::vector<int> association) {
         std::cout << "current simplified associations" << std::endl;
         std::cout << "number of gaps: " << current_gaps.size() << ", number of previous gaps: " << previous_gaps.size() << std::endl;
@@ -1074,7 +1026,7 @@ namespace dynamic_gap
                 } else { // prev right
                     previous_gaps.at(previous_gap_idx).getSimplifiedLCartesian(prev_x, prev_y);
                 }
-                std::cout << "From (" << prev_x << ", " << prev_y << ") to (" << curr_x << ", " << curr_y << ") with a distance of " << simp_distMatrix[pair[0]][pair[1]] << std::endl;
+                std::cout << "From (" << prev_x << ", " << prev_y << ") to (" << curr_x << ", " << curr_y << ") with a distance of " << simp_distMatrix(pair[0], pair[1]) << std::endl;
             } else {
                 std::cout << "From NULL to (" << curr_x << ", " <<  curr_y << ")" << std::endl;
             }
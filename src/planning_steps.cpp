@@ -0,0 +1,158 @@
+#include <dynamic_gap/planning_steps.h>
+#include <dynamic_gap/stage_tracer.h>
+#include <cmath>
+#include <numeric>
+#include <omp.h>
+
+namespace dynamic_gap {
+    void associateGapSet(GapAssociator& associator, std::vector<dynamic_gap::Gap>& gaps,
+                         std::vector<dynamic_gap::Gap>& previous_gaps, const std::string& ns,
+                         DistMatrix& distMatrix, std::vector<int>& association,
+                         const Matrix<double, 1, 3>& v_ego, int* model_idx) {
+        associator.obtainDistMatrix(gaps, previous_gaps, ns, distMatrix);
+        association = associator.associateGaps(distMatrix); // ASSOCIATE GAPS PASSES BY REFERENCE
+        associator.assignModels(association, distMatrix, gaps, previous_gaps, v_ego, model_idx);
+    }
+
+    Matrix<double, 2, 1> gapEndpointMeasurement(dynamic_gap::Gap& gap, bool right,
+                                                const geometry_msgs::PoseStamped& rbt_in_cam) {
+        int idx = right ? gap.RIdx() : gap.LIdx();
+        float dist = right ? gap.RDist() : gap.LDist();
+        // endpoint is in the robot frame, rbt_in_cam is pretty much always 0,0
+        double x = dist * gap.beams().cosAngle(idx) - rbt_in_cam.pose.position.x;
+        double y = dist * gap.beams().sinAngle(idx) - rbt_in_cam.pose.position.y;
+        return Matrix<double, 2, 1>(std::sqrt(std::pow(x, 2) + std::pow(y, 2)), std::atan2(y, x));
+    }
+
+    void updateGapModels(std::vector<dynamic_gap::Gap>& gaps, const geometry_msgs::PoseStamped& rbt_in_cam,
+                         KalmanBatch& kf_batch, const Matrix<double, 1, 3>& a_ego, const Matrix<double, 1, 3>& v_ego,
+                         const std::vector<std::vector<double>>& agent_odom_vects,
+                         const std::vector<std::vector<double>>& agent_vel_vects, double t) {
+        ScopedStageTimer trace(TRACE_UPDATE_MODELS);
+        for (size_t i = 0; i < gaps.size(); i++) {
+            kf_batch.add(gaps[i].right_model, gapEndpointMeasurement(gaps[i], true, rbt_in_cam));
+            kf_batch.add(gaps[i].left_model, gapEndpointMeasurement(gaps[i], false, rbt_in_cam));
+        }
+        // every endpoint of this scan is filtered in one pass, at one timestamp
+        kf_batch.update(a_ego, v_ego, agent_odom_vects, agent_vel_vects, t);
+    }
+
+    void updatePlanningEgoCircle(const ScanView& scan, TrajectoryArbiter& arbiter, GapManipulator& manip,
+                                 GapFeasibilityChecker& feasibility) {
+        arbiter.updateEgoCircle(scan.ptr());
+        manip.updateEgoCircle(scan);
+        feasibility.updateEgoCircle(scan);
+    }
+
+    std::vector<dynamic_gap::Gap> feasibleGaps(GapFeasibilityChecker& feasibility,
+                                               std::vector<dynamic_gap::Gap> observed_gaps) {
+        ScopedStageTimer trace(TRACE_FEASIBILITY);
+        std::vector<dynamic_gap::Gap> feasible_gap_set;
+        for (size_t i = 0; i < observed_gaps.size(); i++) {
+            // obtain crossing point
+            ROS_INFO_STREAM("feasibility check for gap " << i);
+            if (feasibility.indivGapFeasibilityCheck(observed_gaps.at(i))) {
+                observed_gaps.at(i).addTerminalRightInformation();
+                feasible_gap_set.push_back(observed_gaps.at(i));
+            }
+        }
+        return feasible_gap_set;
+    }
+
+    void manipulateGaps(GapManipulator& manip, TrajectoryArbiter& arbiter, std::vector<dynamic_gap::Gap>& gaps,
+                        const geometry_msgs::PoseStamped& local_goal,
+                        const std::vector<std::vector<double>>& agent_odom_vects,
+                        const std::vector<std::vector<double>>& agent_vel_vects) {
+        ScopedStageTimer trace(TRACE_GAP_MANIPULATE);
+        // propagated egocircles for this planning cycle, shared by terminal manipulation and scoring
+        arbiter.buildDynamicEgocircleCache(agent_odom_vects, agent_vel_vects);
+
+        for (size_t i = 0; i < gaps.size(); i++) {
+            ROS_INFO_STREAM("MANIPULATING INITIAL GAP " << i);
+            // MANIPULATE POINTS AT T=0
+            gaps.at(i).initManipIndices();
+
+            manip.reduceGap(gaps.at(i), local_goal, true); // cut down from non convex
+            manip.convertAxialGap(gaps.at(i), true); // swing axial inwards
+            manip.inflateGapSides(gaps.at(i), true); // inflate gap radially
+            manip.radialExtendGap(gaps.at(i), true); // extend behind robot
+            manip.setGapWaypoint(gaps.at(i), local_goal, true); // incorporating dynamic gap types
+
+            // MANIPULATE POINTS AT T=1
+            ROS_INFO_STREAM("MANIPULATING TERMINAL GAP " << i);
+            manip.updateDynamicEgoCircle(gaps.at(i), &arbiter);
+            if (!gaps.at(i).gap_crossed && !gaps.at(i).gap_closed) {
+                manip.reduceGap(gaps.at(i), local_goal, false); // cut down from non convex
+                manip.convertAxialGap(gaps.at(i), false); // swing axial inwards
+            }
+            manip.inflateGapSides(gaps.at(i), false); // inflate gap radially
+            manip.radialExtendGap(gaps.at(i), false); // extend behind robot
+            manip.setTerminalGapWaypoint(gaps.at(i), local_goal); // incorporating dynamic gap type
+        }
+    }
+
+    void generateGapTrajectories(GapTrajGenerator& traj_gen, TrajectoryArbiter& arbiter, std::vector<dynamic_gap::Gap>& gaps,
+                                 const geometry_msgs::PoseStamped& rbt_in_cam, const geometry_msgs::Twist& rbt_vel,
+                                 std::vector<dynamic_gap::Gap> raw_gaps,
+                                 const std::vector<std::vector<double>>& agent_odom_vects,
+                                 const std::vector<std::vector<double>>& agent_vel_vects, bool parallel,
+                                 std::vector<std::tuple<geometry_msgs::PoseArray, std::vector<double>>>& trajs,
+                                 std::vector<std::vector<double>>& scores) {
+        // tasks are laid out as [g2g_0, ahpf_0, g2g_1, ahpf_1, ...] and run independently
+        std::vector<std::tuple<geometry_msgs::PoseArray, std::vector<double>>> g2g_tuples(gaps.size()), ahpf_tuples(gaps.size());
+        std::vector<std::vector<double>> g2g_score_vecs(gaps.size()), ahpf_score_vecs(gaps.size());
+        std::vector<bool> run_g2g_vec(gaps.size());
+        for (size_t i = 0; i < gaps.size(); i++) {
+            run_g2g_vec.at(i) = (gaps.at(i).goal.goalwithin || gaps.at(i).artificial);
+        }
+
+        // model sides/frozen states are shared across all scoring calls, set once up front
+        arbiter.freezeRawModels(raw_gaps);
+
+        int num_tasks = 2 * gaps.size();
+        if (omp_get_dynamic()) omp_set_dynamic(0);
+        #pragma omp parallel for schedule(dynamic) if(parallel)
+        for (int task = 0; task < num_tasks; task++) {
+            int i = task / 2;
+            bool run_g2g = (task % 2 == 0);
+            if (run_g2g && !run_g2g_vec.at(i)) {
+                continue;
+            }
+
+            try {
+                ROS_INFO_STREAM("generating " << (run_g2g ? "g2g" : "ahpf") << " traj for gap: " << i);
+                // TRAJECTORY GENERATED IN RBT FRAME
+                std::tuple<geometry_msgs::PoseArray, std::vector<double>> return_tuple;
+                return_tuple = traj_gen.generateTrajectory(gaps.at(i), rbt_in_cam, rbt_vel, run_g2g);
+                return_tuple = traj_gen.forwardPassTrajectory(return_tuple);
+                std::vector<double> score_vec = arbiter.scoreTrajectory(std::get<0>(return_tuple), std::get<1>(return_tuple), raw_gaps,
+                                                                        agent_odom_vects, agent_vel_vects, false, false);
+                if (run_g2g) {
+                    g2g_tuples.at(i) = return_tuple;
+                    g2g_score_vecs.at(i) = score_vec;
+                } else {
+                    ahpf_tuples.at(i) = return_tuple;
+                    ahpf_score_vecs.at(i) = score_vec;
+                }
+            } catch (...) {
+                ROS_FATAL_STREAM("generateGapTrajectories");
+            }
+        }
+
+        trajs.resize(gaps.size());
+        scores.resize(gaps.size());
+        for (size_t i = 0; i < gaps.size(); i++) {
+            if (run_g2g_vec.at(i)) {
+                double g2g_score = std::accumulate(g2g_score_vecs.at(i).begin(), g2g_score_vecs.at(i).end(), double(0));
+                double ahpf_score = std::accumulate(ahpf_score_vecs.at(i).begin(), ahpf_score_vecs.at(i).end(), double(0));
+                ROS_INFO_STREAM("gap " << i << ", g2g_score: " << g2g_score << ", ahpf_score: " << ahpf_score);
+
+                trajs.at(i) = (g2g_score > ahpf_score) ? g2g_tuples.at(i) : ahpf_tuples.at(i);
+                scores.at(i) = (g2g_score > ahpf_score) ? g2g_score_vecs.at(i) : ahpf_score_vecs.at(i);
+            } else {
+                trajs.at(i) = ahpf_tuples.at(i);
+                scores.at(i) = ahpf_score_vecs.at(i);
+            }
+        }
+    }
+}
@@ -0,0 +1,54 @@
+#include <dynamic_gap/range_min_index.h>
+
+namespace dynamic_gap {
+    void RangeMinIndex::build(const std::vector<float>& ranges) {
+        n = (int) ranges.size();
+        if (n == 0) {
+            num_blocks = 0;
+            return;
+        }
+
+        num_blocks = (n + BLOCK_SIZE - 1) >> BLOCK_SHIFT;
+        int levels = log2(num_blocks) + 1;
+        if (values.size() < (size_t) n) {
+            values.resize(n);
+            masks.resize(n);
+        }
+        if (table.size() < (size_t) levels * num_blocks) {
+            table.resize((size_t) levels * num_blocks);
+        }
+
+        min_value = ranges[0];
+        max_value = ranges[0];
+        for (int b = 0; b < num_blocks; b++) {
+            int start = b << BLOCK_SHIFT;
+            int end = std::min(start + BLOCK_SIZE, n);
+            uint32_t stack = 0;
+            for (int i = start; i < end; i++) {
+                float v = ranges[i];
+                values[i] = v;
+                min_value = std::min(min_value, v);
+                max_value = std::max(max_value, v);
+
+                // pop every stacked beam that is not smaller than this one
+                while (stack != 0 && values[start + 31 - __builtin_clz(stack)] >= v) {
+                    stack &= ~(1u << (31 - __builtin_clz(stack)));
+                }
+                stack |= 1u << (i - start);
+                masks[i] = stack;
+            }
+            // the bottom of the stack at the end of the block is the block minimum
+            table[b] = values[start + __builtin_ctz(stack)];
+        }
+
+        for (int k = 1; k < levels; k++) {
+            const float* prev = &table[(k - 1)*num_blocks];
+            float* curr = &table[k*num_blocks];
+            int half = 1 << (k - 1);
+            int count = num_blocks - (1 << k) + 1;
+            for (int i = 0; i < count; i++) {
+                curr[i] = std::min(prev[i], prev[i + half]);
+            }
+        }
+    }
+}
@@ -0,0 +1,22 @@
+#include <dynamic_gap/scan_view.h>
+
+namespace dynamic_gap {
+    ScanView::ScanView(boost::shared_ptr<sensor_msgs::LaserScan const> msg) : msg_(msg), table_(NULL) {
+        if (msg_) {
+            build(boost::shared_ptr<RangeMinIndex>(new RangeMinIndex));
+        }
+    }
+
+    ScanView::ScanView(boost::shared_ptr<sensor_msgs::LaserScan const> msg, RangeMinIndexPool& pool) : msg_(msg), table_(NULL) {
+        if (msg_) {
+            build(pool.acquire());
+        }
+    }
+
+    void ScanView::build(boost::shared_ptr<RangeMinIndex> index) {
+        table_ = &BeamTable::get(msg_->angle_min, msg_->angle_increment, (int) msg_->ranges.size());
+
+        index->build(msg_->ranges);
+        index_ = index;
+    }
+}
@@ -0,0 +1,184 @@
+#include <dynamic_gap/stage_tracer.h>
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <sstream>
+
+namespace dynamic_gap {
+    static const char* const trace_stage_names[NUM_TRACE_STAGES] = {
+        "hybridScanGap",
+        "mergeGapsOneGo",
+        "obtainDistMatrix",
+        "associateGaps",
+        "update_models",
+        "feasibility",
+        "gapManipulate",
+        "generateTrajectory",
+        "scoreTrajectory",
+        "compareToOldTraj",
+        "ctrlGeneration"
+    };
+
+    const char* traceStageName(TraceStage stage) {
+        return trace_stage_names[stage];
+    }
+
+    LatencyHistogram::LatencyHistogram() {
+        reset();
+    }
+
+    int LatencyHistogram::bucketOf(uint64_t ns) {
+        if (ns < (uint64_t) SUB_BUCKETS) {
+            return (int) ns;
+        }
+        // ns in [2^e, 2^(e+1)) is split into SUB_BUCKETS by its 3 bits below the leading one
+        int e = 63 - __builtin_clzll(ns);
+        int sub = (int) ((ns >> (e - 3)) & (SUB_BUCKETS - 1));
+        return (e - 2) * SUB_BUCKETS + sub;
+    }
+
+    uint64_t LatencyHistogram::bucketLowerNs(int b) {
+        if (b < SUB_BUCKETS) {
+            return (uint64_t) b;
+        }
+        int e = b / SUB_BUCKETS + 2;
+        uint64_t sub = (uint64_t) (b % SUB_BUCKETS);
+        return ((uint64_t) SUB_BUCKETS + sub) << (e - 3);
+    }
+
+    void LatencyHistogram::record(uint64_t ns) {
+        buckets_[bucketOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        count_.fetch_add(1, std::memory_order_relaxed);
+        sum_ns_.fetch_add(ns, std::memory_order_relaxed);
+
+        uint64_t prev_max = max_ns_.load(std::memory_order_relaxed);
+        while (ns > prev_max && !max_ns_.compare_exchange_weak(prev_max, ns, std::memory_order_relaxed)) {}
+    }
+
+    void LatencyHistogram::reset() {
+        for (int b = 0; b < NUM_BUCKETS; b++) {
+            buckets_[b].store(0, std::memory_order_relaxed);
+        }
+        count_.store(0, std::memory_order_relaxed);
+        sum_ns_.store(0, std::memory_order_relaxed);
+        max_ns_.store(0, std::memory_order_relaxed);
+    }
+
+    double LatencyHistogram::meanMs() const {
+        uint64_t n = count();
+        return n == 0 ? 0.0 : (double) sum_ns_.load(std::memory_order_relaxed) / n * 1e-6;
+    }
+
+    double LatencyHistogram::maxMs() const {
+        return (double) max_ns_.load(std::memory_order_relaxed) * 1e-6;
+    }
+
+    double LatencyHistogram::percentileMs(double q) const {
+        uint64_t n = count();
+        if (n == 0) {
+            return 0.0;
+        }
+
+        uint64_t rank = std::max((uint64_t) 1, (uint64_t) std::ceil(q * n));
+        uint64_t max_ns = max_ns_.load(std::memory_order_relaxed);
+        uint64_t seen = 0;
+        for (int b = 0; b < NUM_BUCKETS; b++) {
+            seen += bucketCount(b);
+            if (seen >= rank) {
+                uint64_t upper_ns = (b + 1 < NUM_BUCKETS) ? bucketLowerNs(b + 1) - 1 : std::numeric_limits<uint64_t>::max();
+                return (double) std::min(upper_ns, max_ns) * 1e-6;
+            }
+        }
+        return (double) max_ns * 1e-6;
+    }
+
+    std::atomic<bool> StageTracer::enabled_(false);
+
+    StageTracer& StageTracer::get() {
+        static StageTracer tracer;
+        return tracer;
+    }
+
+    void StageTracer::setEnabled(bool enable) {
+        if (enable && !enabled()) {
+            reset();
+        }
+        enabled_.store(enable, std::memory_order_relaxed);
+    }
+
+    void StageTracer::reset() {
+        for (int s = 0; s < NUM_TRACE_STAGES; s++) {
+            histograms_[s].reset();
+        }
+    }
+
+    diagnostic_msgs::DiagnosticArray StageTracer::toDiagnostics(ros::Time stamp) const {
+        diagnostic_msgs::DiagnosticArray array;
+        array.header.stamp = stamp;
+
+        for (int s = 0; s < NUM_TRACE_STAGES; s++) {
+            const LatencyHistogram& hist = histograms_[s];
+            double p50 = hist.percentileMs(0.5);
+            double p99 = hist.percentileMs(0.99);
+
+            diagnostic_msgs::DiagnosticStatus status;
+            status.level = diagnostic_msgs::DiagnosticStatus::OK;
+            status.name = std::string("dynamic_gap: ") + traceStageName((TraceStage) s);
+            status.hardware_id = "dynamic_gap";
+            std::ostringstream message;
+            message << "p50 " << p50 << " ms, p99 " << p99 << " ms";
+            status.message = message.str();
+
+            std::pair<const char*, double> values[] = {
+                std::make_pair("count", (double) hist.count()),
+                std::make_pair("mean_ms", hist.meanMs()),
+                std::make_pair("p50_ms", p50),
+                std::make_pair("p90_ms", hist.percentileMs(0.9)),
+                std::make_pair("p99_ms", p99),
+                std::make_pair("max_ms", hist.maxMs())
+            };
+            for (const std::pair<const char*, double>& value : values) {
+                diagnostic_msgs::KeyValue kv;
+                kv.key = value.first;
+                std::ostringstream ss;
+                ss << value.second;
+                kv.value = ss.str();
+                status.values.push_back(kv);
+            }
+            array.status.push_back(status);
+        }
+        return array;
+    }
+
+    bool StageTracer::dump(const std::string& path) const {
+        std::ofstream out(path.c_str(), std::ios::out | std::ios::trunc);
+        if (!out) {
+            ROS_WARN_STREAM("StageTracer: could not open " << path);
+            return false;
+        }
+
+        out << "stage,count,mean_ms,p50_ms,p90_ms,p99_ms,max_ms\n";
+        for (int s = 0; s < NUM_TRACE_STAGES; s++) {
+            const LatencyHistogram& hist = histograms_[s];
+            if (hist.count() == 0) {
+                continue;
+            }
+            out << traceStageName((TraceStage) s) << "," << hist.count() << "," << hist.meanMs() << ","
+                << hist.percentileMs(0.5) << "," << hist.percentileMs(0.9) << ","
+                << hist.percentileMs(0.99) << "," << hist.maxMs() << "\n";
+        }
+
+        out << "\nstage,bucket_lower_ns,count\n";
+        for (int s = 0; s < NUM_TRACE_STAGES; s++) {
+            const LatencyHistogram& hist = histograms_[s];
+            for (int b = 0; b < LatencyHistogram::NUM_BUCKETS; b++) {
+                uint64_t n = hist.bucketCount(b);
+                if (n > 0) {
+                    out << traceStageName((TraceStage) s) << "," << LatencyHistogram::bucketLowerNs(b) << "," << n << "\n";
+                }
+            }
+        }
+        return true;
+    }
+}
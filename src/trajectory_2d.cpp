@@ -0,0 +1,78 @@
+#include <dynamic_gap/trajectory_2d.h>
+#include <cmath>
+
+namespace dynamic_gap {
+    namespace {
+        double quaternionYaw(double x, double y, double z, double w) {
+            return std::atan2(2.0 * (w * z + x * y), 1.0 - 2.0 * (y * y + z * z));
+        }
+    }
+
+    SE2Transform SE2Transform::fromTransform(const geometry_msgs::TransformStamped& tf) {
+        const geometry_msgs::Quaternion& q = tf.transform.rotation;
+        return SE2Transform(tf.transform.translation.x, tf.transform.translation.y, quaternionYaw(q.x, q.y, q.z, q.w));
+    }
+
+    SE2Transform SE2Transform::operator*(const SE2Transform& other) const {
+        double c = std::cos(yaw), s = std::sin(yaw);
+        return SE2Transform(c * other.x - s * other.y + x, s * other.x + c * other.y + y, yaw + other.yaw);
+    }
+
+    Trajectory2D::Trajectory2D(const geometry_msgs::PoseArray& pose_arr, const std::vector<double>& time_arr) {
+        boost::shared_ptr<Samples> samples(new Samples);
+        int n = pose_arr.poses.size();
+        samples->x.resize(n);
+        samples->y.resize(n);
+        samples->yaw.resize(n);
+        for (int i = 0; i < n; i++) {
+            const geometry_msgs::Pose& pose = pose_arr.poses[i];
+            samples->x[i] = pose.position.x;
+            samples->y[i] = pose.position.y;
+            samples->yaw[i] = quaternionYaw(pose.orientation.x, pose.orientation.y, pose.orientation.z, pose.orientation.w);
+        }
+        samples->t = time_arr;
+        samples_ = samples;
+        frame_id_ = pose_arr.header.frame_id;
+        stamp_ = pose_arr.header.stamp;
+    }
+
+    const std::vector<double>& Trajectory2D::times() const {
+        static const std::vector<double> no_times;
+        return samples_ ? samples_->t : no_times;
+    }
+
+    Trajectory2D Trajectory2D::transformed(const SE2Transform& target_from_current, const std::string& frame_id) const {
+        Trajectory2D ret = *this;
+        ret.transform_ = target_from_current * transform_;
+        ret.frame_id_ = frame_id;
+        ret.stamp_ = ros::Time::now();
+        return ret;
+    }
+
+    Trajectory2D Trajectory2D::transformed(const geometry_msgs::TransformStamped& target_from_current) const {
+        return transformed(SE2Transform::fromTransform(target_from_current), target_from_current.header.frame_id);
+    }
+
+    geometry_msgs::PoseArray Trajectory2D::toPoseArray() const {
+        geometry_msgs::PoseArray pose_arr;
+        pose_arr.header.frame_id = frame_id_;
+        pose_arr.header.stamp = stamp_;
+
+        int n = size();
+        pose_arr.poses.resize(n);
+        double c = std::cos(transform_.yaw), s = std::sin(transform_.yaw);
+        for (int i = 0; i < n; i++) {
+            double x = samples_->x[i], y = samples_->y[i];
+            double half_yaw = 0.5 * (samples_->yaw[i] + transform_.yaw);
+            geometry_msgs::Pose& pose = pose_arr.poses[i];
+            pose.position.x = c * x - s * y + transform_.x;
+            pose.position.y = s * x + c * y + transform_.y;
+            pose.position.z = 0.0;
+            pose.orientation.x = 0.0;
+            pose.orientation.y = 0.0;
+            pose.orientation.z = std::sin(half_yaw);
+            pose.orientation.w = std::cos(half_yaw);
+        }
+        return pose_arr;
+    }
+}
@@ -8,21 +8,21 @@ namespace dynamic_gap{
         last_time = ros::Time::now();
     }
 
-    void TrajectoryController::updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg)
+    void TrajectoryController::updateEgoCircle(const ScanView& scan_view)
     {
         boost::mutex::scoped_lock lock(egocircle_l);
-        msg_ = msg;
+        scan_view_ = scan_view;
     }
 
     std::vector<geometry_msgs::Point> TrajectoryController::findLocalLine(int min_dist_idx) {
+        if (!scan_view_.valid()) {
+            return std::vector<geometry_msgs::Point>(0);
+        }
+
         // get egocircle measurement
-        auto egocircle = *msg_.get();
+        const sensor_msgs::LaserScan& egocircle = scan_view_.scan();
         std::vector<double> scan_interpoint_dists(egocircle.ranges.size());
 
-        if (!msg_) {
-            return std::vector<geometry_msgs::Point>(0);
-        }
-        
         if (egocircle.ranges.size() < 500) {
             ROS_FATAL_STREAM("Scan range incorrect findLocalLine");
         }
@@ -33,10 +33,10 @@ namespace dynamic_gap{
         for (int i = 1; i < scan_interpoint_dists.size(); i++) {
             // current distance/idx
             range_i = egocircle.ranges.at(i);
-            theta_i = float(i) * egocircle.angle_increment + egocircle.angle_min;
+            theta_i = scan_view_.angle(i);
             // prior distance/idx
             range_imin1 = egocircle.ranges.at(i - 1);
-            theta_imin1 = float(i - 1) * egocircle.angle_increment + egocircle.angle_min;
+            theta_imin1 = scan_view_.angle(i - 1);
             
             // if current distance is big, set dist to big
             if (range_i > 2.9) {
@@ -47,7 +47,7 @@ namespace dynamic_gap{
             } 
         }
 
-        scan_interpoint_dists.at(0) = polDist(egocircle.ranges.at(0), egocircle.angle_min, egocircle.ranges.at(511), float(511) * egocircle.angle_increment + egocircle.angle_min);
+        scan_interpoint_dists.at(0) = polDist(egocircle.ranges.at(0), scan_view_.angle(0), egocircle.ranges.at(511), scan_view_.angle(511));
 
         // searching forward for the first place where interpoint distances exceed threshold (0.1) (starting from the min_dist_idx).
         auto result_fwd = std::find_if(scan_interpoint_dists.begin() + min_dist_idx, scan_interpoint_dists.end(), 
@@ -77,8 +77,8 @@ namespace dynamic_gap{
         float dist_rev = egocircle.ranges.at(idx_rev);
         float dist_cent = egocircle.ranges.at(min_dist_idx);
 
-        double angle_fwd = double(idx_fwd) * egocircle.angle_increment + egocircle.angle_min;
-        double angle_rev = double(idx_rev) * egocircle.angle_increment + egocircle.angle_min;
+        double angle_fwd = scan_view_.angle(idx_fwd);
+        double angle_rev = scan_view_.angle(idx_rev);
         
         if (idx_fwd < min_dist_idx || idx_rev > min_dist_idx) {
             return std::vector<geometry_msgs::Point>(0);
@@ -86,7 +86,7 @@ namespace dynamic_gap{
 
         Eigen::Vector2d fwd_polar(dist_fwd, angle_fwd);
         Eigen::Vector2d rev_polar(dist_rev, angle_rev);
-        Eigen::Vector2d cent_polar(dist_cent, double(min_dist_idx) * egocircle.angle_increment + egocircle.angle_min);
+        Eigen::Vector2d cent_polar(dist_cent, scan_view_.angle(min_dist_idx));
         Eigen::Vector2d fwd_cart = pol2car(fwd_polar);
         Eigen::Vector2d rev_cart = pol2car(rev_polar);
         Eigen::Vector2d cent_cart = pol2car(cent_polar);
@@ -139,16 +139,16 @@ namespace dynamic_gap{
 
     */
     geometry_msgs::Twist TrajectoryController::obstacleAvoidanceControlLaw(
-                                    sensor_msgs::LaserScan inflated_egocircle) {
-        sensor_msgs::LaserScan scan_ = inflated_egocircle;
+                                    const sensor_msgs::LaserScan& inflated_egocircle) {
+        const sensor_msgs::LaserScan& scan_ = inflated_egocircle;
+        const BeamTable& beams = BeamTable::get(scan_.angle_min, scan_.angle_increment, (int) scan_.ranges.size());
         float linear = 0, rotational = 0;
         
         for(unsigned int i = 0 ; i < scan_.ranges.size() ; i++) {
             float real_dist = scan_.ranges[i];
-            float real_idx =  scan_.angle_min + i * scan_.angle_increment;
             float r_offset = 0.125; // 0.25 cut it pretty close on one example
-            linear -= cos(real_idx) / (r_offset + real_dist * real_dist);
-            rotational -= sin(real_idx) / (r_offset + real_dist * real_dist);
+            linear -= beams.cosAngle(i) / (r_offset + real_dist * real_dist);
+            rotational -= beams.sinAngle(i) / (r_offset + real_dist * real_dist);
         }
         geometry_msgs::Twist cmd;
         
@@ -172,7 +172,7 @@ namespace dynamic_gap{
 
     geometry_msgs::Twist TrajectoryController::controlLaw(
         geometry_msgs::Pose current, nav_msgs::Odometry desired,
-        sensor_msgs::LaserScan inflated_egocircle, geometry_msgs::PoseStamped rbt_in_cam_lc,
+        const sensor_msgs::LaserScan& inflated_egocircle, geometry_msgs::PoseStamped rbt_in_cam_lc,
         geometry_msgs::Twist current_rbt_vel, geometry_msgs::Twist rbt_accel,
         dynamic_gap::cart_model * curr_right_model, dynamic_gap::cart_model * curr_left_model,
         double curr_peak_velocity_x, double curr_peak_velocity_y) {
@@ -510,7 +510,7 @@ namespace dynamic_gap{
         return d_h_left_dx;
     }
 
-    void TrajectoryController::run_projection_operator(sensor_msgs::LaserScan inflated_egocircle, 
+    void TrajectoryController::run_projection_operator(const sensor_msgs::LaserScan& inflated_egocircle, 
                                                         geometry_msgs::PoseStamped rbt_in_cam_lc,
                                                         Eigen::Vector2d cmd_vel_fb,
                                                         Eigen::Vector2d & Psi_der, double & Psi,
@@ -529,11 +529,12 @@ namespace dynamic_gap{
 
         // iterates through current egocircle and finds the minimum distance to the robot's pose
         ROS_INFO_STREAM("rbt_in_cam_lc pose: " << rbt_in_cam_lc.pose.position.x << ", " << rbt_in_cam_lc.pose.position.y);
+        const BeamTable& beams = BeamTable::get(-M_PI, inflated_egocircle.angle_increment, (int) inflated_egocircle.ranges.size());
+        std::vector<float> scan_x, scan_y;
+        beams.toCartesian(inflated_egocircle.ranges, scan_x, scan_y);
         std::vector<double> min_dist_arr(inflated_egocircle.ranges.size());
         for (int i = 0; i < min_dist_arr.size(); i++) {
-            float angle = i * inflated_egocircle.angle_increment - M_PI;
-            float dist = inflated_egocircle.ranges.at(i);
-            min_dist_arr.at(i) = dist2Pose(angle, dist, rbt_in_cam_lc.pose);
+            min_dist_arr.at(i) = sqrt(pow(rbt_in_cam_lc.pose.position.x - scan_x[i], 2) + pow(rbt_in_cam_lc.pose.position.y - scan_y[i], 2));
         }
         int min_idx = std::min_element( min_dist_arr.begin(), min_dist_arr.end() ) - min_dist_arr.begin();
 
@@ -3,14 +3,19 @@
 
 
 namespace dynamic_gap {
-    TrajectoryArbiter::TrajectoryArbiter(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg)
+    TrajectoryArbiter::TrajectoryArbiter(ros::NodeHandle& nh, const dynamic_gap::DynamicGapConfig& cfg) : TrajectoryArbiter(cfg)
+    {
+        propagatedEgocirclePublisher = nh.advertise<sensor_msgs::LaserScan>("propagated_egocircle", 500);
+    }
+
+    TrajectoryArbiter::TrajectoryArbiter(const dynamic_gap::DynamicGapConfig& cfg)
     {
         cfg_ = & cfg;
         r_inscr = cfg_->rbt.r_inscr;
         rmax = cfg_->traj.rmax;
         cobs = cfg_->traj.cobs;
         w = cfg_->traj.w;
-        propagatedEgocirclePublisher = nh.advertise<sensor_msgs::LaserScan>("propagated_egocircle", 500);
+        ROS_INFO_STREAM("beam intersection kernel: " << beamIntersectionKernel());
     }
 
     void TrajectoryArbiter::updateEgoCircle(boost::shared_ptr<sensor_msgs::LaserScan const> msg_) {
@@ -62,15 +67,54 @@ namespace dynamic_gap {
                                                         std::vector<std::vector<double>> _agent_vel_vects,
                                                         sensor_msgs::LaserScan& dynamic_laser_scan,
                                                         bool print) {
+        // one-off propagation, start from a fresh static scan
+        boost::shared_ptr<sensor_msgs::LaserScan const> static_scan;
+        {
+            boost::mutex::scoped_lock lock(egocircle_mutex);
+            static_scan = static_msg;
+        }
+        DynamicEgocircleState state(static_scan);
+        recoverDynamicEgocircleCheat(t_i, t_iplus1, _agent_odom_vects, _agent_vel_vects, dynamic_laser_scan, state, print);
+    }
+
+    void TrajectoryArbiter::recoverDynamicEgocircleCheat(double t_i, double t_iplus1, 
+                                                        std::vector<std::vector<double>> & _agent_odom_vects, 
+                                                        const std::vector<std::vector<double>> & _agent_vel_vects,
+                                                        sensor_msgs::LaserScan& dynamic_laser_scan,
+                                                        DynamicEgocircleState& state,
+                                                        bool print) {
         double interval = t_iplus1 - t_i;
         if (interval <= 0.0) {
             return;
         }
         if (print) ROS_INFO_STREAM("recovering dynamic egocircle with cheat for interval: " << t_i << " to " << t_iplus1);
-        // for EVERY interval, start with static scan
-        dynamic_laser_scan.ranges = static_msg.get()->ranges;
 
         float max_range = 5.0;
+        int num_beams;
+        // for EVERY interval, start with static scan. Only the first interval copies the whole scan,
+        // after that only the beams that agents wrote into last interval get restored
+        if (!state.primed) {
+            if (!state.static_scan) {
+                ROS_WARN_STREAM("recoverDynamicEgocircleCheat: no static egocircle to propagate from");
+                return;
+            }
+            const std::vector<float> & static_ranges = state.static_scan.get()->ranges;
+            num_beams = static_ranges.size();
+            state.base_ranges.resize(num_beams);
+            for (int i = 0; i < num_beams; i++) {
+                state.base_ranges[i] = std::min(static_ranges[i], max_range);
+            }
+            dynamic_laser_scan.ranges = state.base_ranges;
+            state.primed = true;
+        } else {
+            for (int i : state.dirty_beams) {
+                dynamic_laser_scan.ranges[i] = state.base_ranges[i];
+            }
+        }
+        state.dirty_beams.clear();
+        num_beams = dynamic_laser_scan.ranges.size();
+        const BeamTable& beams = BeamTable::get(dynamic_laser_scan.angle_min, dynamic_laser_scan.angle_increment, num_beams);
+
         // propagate poses forward (all odoms and vels are in robot frame)
         for (int i = 0; i < _agent_odom_vects.size(); i++) {
             if (print) ROS_INFO_STREAM("robot" << i << " moving from (" << _agent_odom_vects[i][0] << ", " << _agent_odom_vects[i][1] << ")");
@@ -79,83 +123,107 @@ namespace dynamic_gap {
             if (print) ROS_INFO_STREAM("to (" << _agent_odom_vects[i][0] << ", " << _agent_odom_vects[i][1] << ")");
         }
 
-        // basically run modify_scan                                                          
-
-        Eigen::Vector2d pt2, centered_pt1, centered_pt2, dx_dy, intersection0, intersection1, 
-                        int0_min_cent_pt1, int0_min_cent_pt2, int1_min_cent_pt1, int1_min_cent_pt2, 
-                        cent_pt2_min_cent_pt1;
-        double rad, dist, dx, dy, dr, D, discriminant, dist0, dist1;
-        std::vector<double> other_state;
-        for (int i = 0; i < dynamic_laser_scan.ranges.size(); i++) {
-            rad = dynamic_laser_scan.angle_min + i*dynamic_laser_scan.angle_increment;
-            // cout << "i: " << i << " rad: " << rad << endl;
-            // cout << "original distance " << modified_laser_scan.ranges[i] << endl;
-            dynamic_laser_scan.ranges[i] = std::min(dynamic_laser_scan.ranges[i], max_range);
-            // ROS_INFO_STREAM("i: " << i << ", rad: " << rad << ", range: " << dynamic_laser_scan.ranges[i]);
-            dist = dynamic_laser_scan.ranges[i];
-            
-            pt2 << dist*cos(rad), dist*sin(rad);
-
-            // map<string, vector<double>>::iterator it;
-            //vector<pair<string, vector<double> >> odom_vect = sort_and_prune(odom_map);
-            // TODO: sort map here according to distance from robot. Then, can break after first intersection
-            for (int j = 0; j < _agent_odom_vects.size(); j++) {
-                other_state = _agent_odom_vects[j];
-                // ROS_INFO_STREAM("ODOM MAP SECOND: " << other_state[0] << ", " << other_state[1]);
-                // int idx_dist = std::distance(odom_map.begin(), it);
-                // ROS_INFO_STREAM("EGO ROBOT ODOM: " << pt1[0] << ", " << pt1[1]);
-                // ROS_INFO_STREAM("ODOM VECT SECOND: " << other_state[0] << ", " << other_state[1]);
-
-                // centered ego robot state
-                centered_pt1 << -other_state[0], -other_state[1]; 
-                // ROS_INFO_STREAM("centered_pt1: " << centered_pt1[0] << ", " << centered_pt1[1]);
-
-                // static laser scan point
-                centered_pt2 << pt2[0] - other_state[0], pt2[1] - other_state[1]; 
-                // ROS_INFO_STREAM("centered_pt2: " << centered_pt2[0] << ", " << centered_pt2[1]);
-
-                dx = centered_pt2[0] - centered_pt1[0];
-                dy = centered_pt2[1] - centered_pt1[1];
-                dx_dy << dx, dy;
-                dr = dx_dy.norm();
-
-                D = centered_pt1[0]*centered_pt2[1] - centered_pt2[0]*centered_pt1[1];
-                discriminant = pow(r_inscr,2) * pow(dr, 2) - pow(D, 2);
-
-                if (discriminant > 0) {
-                    intersection0 << (D*dy + sgn_star(dy) * dx * sqrt(discriminant)) / pow(dr, 2),
-                                     (-D * dx + abs(dy)*sqrt(discriminant)) / pow(dr, 2);
-                                        
-                    intersection1 << (D*dy - sgn_star(dy) * dx * sqrt(discriminant)) / pow(dr, 2),
-                                     (-D * dx - abs(dy)*sqrt(discriminant)) / pow(dr, 2);
-                    int0_min_cent_pt1 = intersection0 - centered_pt1;
-                    int1_min_cent_pt1 = intersection1 - centered_pt1;
-                    cent_pt2_min_cent_pt1 = centered_pt2 - centered_pt1;
-
-                    dist0 = int0_min_cent_pt1.norm();
-                    dist1 = int1_min_cent_pt1.norm();
-                    
-                    if (dist0 < dist1) {
-                        int0_min_cent_pt2 = intersection0 - centered_pt2;
-
-                        if (dist0 < dynamic_laser_scan.ranges[i] && dist0 < cent_pt2_min_cent_pt1.norm() && int0_min_cent_pt2.norm() < cent_pt2_min_cent_pt1.norm() ) {
-                            if (print) ROS_INFO_STREAM("at i: " << i << ", changed distance from " << dynamic_laser_scan.ranges[i] << " to " << dist0);
-                            dynamic_laser_scan.ranges[i] = dist0;
-                            // break;
-                        }
-                    } else {
-                        int1_min_cent_pt2 = intersection1 - centered_pt2;
+        // basically run modify_scan, but only over the beams each agent can actually intersect.
+        // A beam can only hit an agent if it is within asin(r_inscr / d) of the agent's bearing,
+        // (one beam of slack on each side), unless the robot is inside the agent's circle
+        double agent_dist, agent_bearing, half_width;
+        int lo_idx, hi_idx, span;
+        auto clipBeams = [&](const std::vector<double> & other_state, int begin, int end) {
+            intersectAgentWithBeams(other_state[0], other_state[1], r_inscr, beams.cosData(), beams.sinData(),
+                                    state.base_ranges.data(), dynamic_laser_scan.ranges.data(), begin, end);
+            for (int k = begin; k < end; k++) {
+                state.dirty_beams.push_back(k);
+            }
+        };
+        for (int j = 0; j < _agent_odom_vects.size(); j++) {
+            const std::vector<double> & other_state = _agent_odom_vects[j];
+            agent_dist = sqrt(pow(other_state[0], 2) + pow(other_state[1], 2));
+            if (agent_dist <= r_inscr) {
+                lo_idx = 0;
+                hi_idx = num_beams - 1;
+            } else {
+                agent_bearing = std::atan2(other_state[1], other_state[0]);
+                half_width = std::asin(r_inscr / agent_dist);
+                lo_idx = (int) std::floor((agent_bearing - half_width - dynamic_laser_scan.angle_min) / dynamic_laser_scan.angle_increment) - 1;
+                hi_idx = (int) std::ceil((agent_bearing + half_width - dynamic_laser_scan.angle_min) / dynamic_laser_scan.angle_increment) + 1;
+                hi_idx = std::min(hi_idx, lo_idx + num_beams - 1);
+            }
 
-                        if (dist1 < dynamic_laser_scan.ranges[i] && dist1 < cent_pt2_min_cent_pt1.norm() && int1_min_cent_pt2.norm() < cent_pt2_min_cent_pt1.norm() ) {
-                            if (print) ROS_INFO_STREAM("at i: " << i << ", changed distance from " << dynamic_laser_scan.ranges[i] << " to " << dist1);                        
-                            dynamic_laser_scan.ranges[i] = dist1;
-                            // break;
-                        }
-                    }
-                }
+            // the window can wrap past either end of the scan, so run it as up to two contiguous spans
+            span = hi_idx - lo_idx + 1;
+            lo_idx = ((lo_idx % num_beams) + num_beams) % num_beams;
+            if (lo_idx + span <= num_beams) {
+                clipBeams(other_state, lo_idx, lo_idx + span);
+            } else {
+                clipBeams(other_state, lo_idx, num_beams);
+                clipBeams(other_state, 0, lo_idx + span - num_beams);
             }
+            if (print) ROS_INFO_STREAM("agent " << j << " clipped " << span << " beams from " << lo_idx);
         }
-    
+    }
+
+    void TrajectoryArbiter::buildDynamicEgocircleCache(const std::vector<std::vector<double>> & _agent_odom_vects, 
+                                                       const std::vector<std::vector<double>> & _agent_vel_vects) {
+        boost::shared_ptr<sensor_msgs::LaserScan const> scan, static_scan;
+        {
+            boost::mutex::scoped_lock lock(egocircle_mutex);
+            scan = msg;
+            static_scan = static_msg;
+        }
+
+        int num_steps = (int) std::ceil(cfg_->traj.integrate_maxt / cfg_->traj.integrate_stept);
+        // planning can run more than once on the same scans and agent states, nothing to redo then
+        if (scan && static_scan && scan == cache_scan && static_scan == cache_static_scan && 
+            cache_stept == cfg_->traj.integrate_stept && int(dynamic_egocircle_cache.size()) == num_steps + 1 &&
+            _agent_odom_vects == cache_agent_odoms && _agent_vel_vects == cache_agent_vels) {
+            return;
+        }
+
+        dynamic_egocircle_cache.clear();
+        dynamic_egocircle_min.clear();
+        cache_scan.reset();
+        cache_static_scan.reset();
+        if (!scan || !static_scan) {
+            ROS_WARN_STREAM("buildDynamicEgocircleCache: no egocircle yet");
+            return;
+        }
+
+        cache_stept = cfg_->traj.integrate_stept;
+        cache_scan = scan;
+        cache_static_scan = static_scan;
+        cache_agent_odoms = _agent_odom_vects;
+        cache_agent_vels = _agent_vel_vects;
+
+        // t = 0 is the current egocircle, as in scoreTrajectory
+        sensor_msgs::LaserScan dynamic_laser_scan = *scan.get();
+        dynamic_laser_scan.intensities = std::vector<float>(scan.get()->ranges.size(), 0.5);
+        dynamic_egocircle_cache.reserve(num_steps + 1);
+        dynamic_egocircle_cache.push_back(dynamic_laser_scan);
+        dynamic_egocircle_min.push_back(*std::min_element(dynamic_laser_scan.ranges.begin(), dynamic_laser_scan.ranges.end()));
+
+        std::vector<std::vector<double>> propagated_odom_vects = _agent_odom_vects;
+        // propagate from the static scan the reuse check above compared against
+        DynamicEgocircleState propagation_state(static_scan);
+        for (int k = 1; k <= num_steps; k++) {
+            recoverDynamicEgocircleCheat((k - 1) * cache_stept, k * cache_stept, propagated_odom_vects, _agent_vel_vects, 
+                                         dynamic_laser_scan, propagation_state, false);
+            dynamic_egocircle_cache.push_back(dynamic_laser_scan);
+            dynamic_egocircle_min.push_back(*std::min_element(dynamic_laser_scan.ranges.begin(), dynamic_laser_scan.ranges.end()));
+        }
+    }
+
+    int TrajectoryArbiter::cacheStep(double t) {
+        // times off of the grid (i.e. gap lifespans) are snapped to the nearest step
+        int k = (int) std::round(t / cache_stept);
+        return std::max(0, std::min(k, int(dynamic_egocircle_cache.size()) - 1));
+    }
+
+    const sensor_msgs::LaserScan& TrajectoryArbiter::getCachedDynamicEgocircle(double t) {
+        return dynamic_egocircle_cache.at(cacheStep(t));
+    }
+
+    float TrajectoryArbiter::getCachedDynamicEgocircleMin(double t) {
+        return dynamic_egocircle_min.at(cacheStep(t));
     }
 
     void TrajectoryArbiter::recoverDynamicEgoCircle(double t_i, double t_iplus1, std::vector<dynamic_gap::cart_model *> raw_models, sensor_msgs::LaserScan& dynamic_laser_scan) {
@@ -357,27 +425,19 @@ namespace dynamic_gap {
     }
 
     void TrajectoryArbiter::visualizePropagatedEgocircle(sensor_msgs::LaserScan dynamic_laser_scan) {
-        propagatedEgocirclePublisher.publish(dynamic_laser_scan);
+        if (propagatedEgocirclePublisher) {
+            propagatedEgocirclePublisher.publish(dynamic_laser_scan);
+        }
     }
 
 
-    std::vector<double> TrajectoryArbiter::scoreTrajectory(geometry_msgs::PoseArray traj, 
-                                                           std::vector<double> time_arr, std::vector<dynamic_gap::Gap>& current_raw_gaps,
-                                                           std::vector<std::vector<double>> _agent_odom_vects, 
-                                                           std::vector<std::vector<double>> _agent_vel_vects,
-                                                           bool print,
-                                                           bool vis) {
-        // Requires LOCAL FRAME
-        // Should be no racing condition
-        double start_time = ros::WallTime::now().toSec();
-
+    void TrajectoryArbiter::freezeRawModels(std::vector<dynamic_gap::Gap>& current_raw_gaps) {
         std::vector<dynamic_gap::cart_model *> raw_models;
         for (auto gap : current_raw_gaps) {
             raw_models.push_back(gap.right_model);
             raw_models.push_back(gap.left_model);
         }
         
-        
         // std::cout << "starting setting sides and freezing velocities" << std::endl;
         int count = 0;
         for (auto & model : raw_models) {
@@ -389,7 +449,37 @@ namespace dynamic_gap {
             count++;
             model->freeze_robot_vel();
         }
-        
+    }
+
+    std::vector<double> TrajectoryArbiter::scoreTrajectory(geometry_msgs::PoseArray traj, 
+                                                           std::vector<double> time_arr, std::vector<dynamic_gap::Gap>& current_raw_gaps,
+                                                           std::vector<std::vector<double>> _agent_odom_vects, 
+                                                           std::vector<std::vector<double>> _agent_vel_vects,
+                                                           bool print,
+                                                           bool vis) {
+        double start_time = ros::WallTime::now().toSec();
+        std::vector<double> cost_val = scorePoses(traj, time_arr, current_raw_gaps, _agent_odom_vects, _agent_vel_vects, print);
+        cost_val = applyTerminalCost(traj, cost_val);
+        ROS_INFO_STREAM("scoreTrajectory time taken:" << ros::WallTime::now().toSec() - start_time);
+        return cost_val;
+    }
+
+    std::vector<double> TrajectoryArbiter::scorePoses(const geometry_msgs::PoseArray& traj, 
+                                                      const std::vector<double>& time_arr, std::vector<dynamic_gap::Gap>& current_raw_gaps,
+                                                      std::vector<std::vector<double>> _agent_odom_vects, 
+                                                      const std::vector<std::vector<double>>& _agent_vel_vects,
+                                                      bool print) {
+        ScopedStageTimer trace(TRACE_SCORE_TRAJECTORY);
+        // Requires LOCAL FRAME
+        // Should be no racing condition, may be called concurrently from initialTrajGen
+        // so raw models are frozen beforehand (freezeRawModels) and egocircle is grabbed once
+        boost::shared_ptr<sensor_msgs::LaserScan const> scan, static_scan;
+        {
+            boost::mutex::scoped_lock lock(egocircle_mutex);
+            scan = msg;
+            static_scan = static_msg;
+        }
+
         // std::cout << "num models: " << raw_models.size() << std::endl;
         std::vector<std::vector<double>> dynamic_min_dist_pts(traj.poses.size());
         std::vector<double> dynamic_cost_val(traj.poses.size());
@@ -398,7 +488,7 @@ namespace dynamic_gap {
         double total_val = 0.0;
         std::vector<double> cost_val;
 
-        sensor_msgs::LaserScan stored_scan = *msg.get();
+        const sensor_msgs::LaserScan& stored_scan = *scan.get();
         sensor_msgs::LaserScan dynamic_laser_scan = sensor_msgs::LaserScan();
         dynamic_laser_scan.header = stored_scan.header;
         dynamic_laser_scan.angle_min = stored_scan.angle_min;
@@ -418,23 +508,27 @@ namespace dynamic_gap {
 
         int min_dist_idx;
         if (current_raw_gaps.size() > 0) {
+            // fall back to propagating here if the planning cycle did not build the cache
+            bool use_cache = hasDynamicEgocircleCache();
+            DynamicEgocircleState propagation_state(static_scan);
             for (int i = 0; i < dynamic_cost_val.size(); i++) {
                 // std::cout << "regular range at " << i << ": ";
                 t_iplus1 = time_arr[i];
-                // need to hook up static scan
-                recoverDynamicEgocircleCheat(t_i, t_iplus1, _agent_odom_vects, _agent_vel_vects, dynamic_laser_scan, print);
-                // recoverDynamicEgoCircle(t_i, t_iplus1, raw_models, dynamic_laser_scan);
+                if (!use_cache) {
+                    recoverDynamicEgocircleCheat(t_i, t_iplus1, _agent_odom_vects, _agent_vel_vects, dynamic_laser_scan, propagation_state, print);
+                }
+                const sensor_msgs::LaserScan& step_laser_scan = use_cache ? getCachedDynamicEgocircle(t_iplus1) : dynamic_laser_scan;
                 /*
                 if (i == 1 && vis) {
                     ROS_INFO_STREAM("visualizing dynamic egocircle from " << t_i << " to " << t_iplus1);
-                    visualizePropagatedEgocircle(dynamic_laser_scan); // if I do i ==0, that's just original scan
+                    visualizePropagatedEgocircle(step_laser_scan); // if I do i ==0, that's just original scan
                 }
                 */
 
-                min_dist_idx = dynamicGetMinDistIndex(traj.poses.at(i), dynamic_laser_scan, print);
+                min_dist_idx = dynamicGetMinDistIndex(traj.poses.at(i), step_laser_scan, print);
                 // add point to min_dist_array
-                double theta = min_dist_idx * dynamic_laser_scan.angle_increment + dynamic_laser_scan.angle_min;
-                double range = dynamic_laser_scan.ranges.at(min_dist_idx);
+                double theta = min_dist_idx * step_laser_scan.angle_increment + step_laser_scan.angle_min;
+                double range = step_laser_scan.ranges.at(min_dist_idx);
                 std::vector<double> min_dist_pt{range*std::cos(theta), range*std::sin(theta)};
                 dynamic_min_dist_pts.at(i) = min_dist_pt;
 
@@ -453,15 +547,20 @@ namespace dynamic_gap {
         } else {
             for (int i = 0; i < static_cost_val.size(); i++) {
                 // std::cout << "regular range at " << i << ": ";
-                static_cost_val.at(i) = scorePose(traj.poses.at(i)); //  / static_cost_val.size()
+                static_cost_val.at(i) = scorePose(traj.poses.at(i), stored_scan); //  / static_cost_val.size()
             }
             total_val = std::accumulate(static_cost_val.begin(), static_cost_val.end(), double(0));
             cost_val = static_cost_val;
             ROS_INFO_STREAM("static pose-wise cost: " << total_val);
         }
 
+        return cost_val;
+    }
+
+    std::vector<double> TrajectoryArbiter::applyTerminalCost(const geometry_msgs::PoseArray& traj, std::vector<double> cost_val) {
         if (cost_val.size() > 0) 
         {
+            double total_val = std::accumulate(cost_val.begin(), cost_val.end(), double(0));
             // obtain terminalGoalCost, scale by w1
             double w1 = 0.5;
             auto terminal_cost = w1 * terminalGoalCost(*std::prev(traj.poses.end()));
@@ -474,8 +573,6 @@ namespace dynamic_gap {
             ROS_INFO_STREAM("terminal cost: " << -terminal_cost);
             cost_val.at(0) -= terminal_cost;
         }
-        
-        ROS_INFO_STREAM("scoreTrajectory time taken:" << ros::WallTime::now().toSec() - start_time);
         return cost_val;
     }
 
@@ -496,33 +593,56 @@ namespace dynamic_gap {
         return sqrt(pow(pose.position.x - x, 2) + pow(pose.position.y - y, 2));
     }
 
-    int TrajectoryArbiter::dynamicGetMinDistIndex(geometry_msgs::Pose pose, sensor_msgs::LaserScan dynamic_laser_scan, bool print) {
-        boost::mutex::scoped_lock lock(egocircle_mutex);
+    int TrajectoryArbiter::dynamicGetMinDistIndex(geometry_msgs::Pose pose, const sensor_msgs::LaserScan& dynamic_laser_scan, bool print) {
+        double min_dist;
+        return nearestEgocircleIndex(pose, dynamic_laser_scan, min_dist);
+    }
 
-        // obtain orientation and idx of pose
-        double pose_ori = std::atan2(pose.position.y + 1e-3, pose.position.x + 1e-3);
-        int center_idx = (int) std::round((pose_ori + M_PI) / msg.get()->angle_increment);
-        
-        int scan_size = (int) dynamic_laser_scan.ranges.size();
-        // dist is size of scan
-        std::vector<double> dist(scan_size);
+    int TrajectoryArbiter::nearestEgocircleIndex(const geometry_msgs::Pose& pose, const sensor_msgs::LaserScan& scan, double& min_dist) {
+        int scan_size = (int) scan.ranges.size();
 
         // This size **should** be ensured
-        if (dynamic_laser_scan.ranges.size() < 500) {
+        if (scan_size < 500) {
             ROS_FATAL_STREAM("Scan range incorrect scorePose");
         }
 
-        // iterate through ranges and obtain the distance from the egocircle point and the pose
-        // Meant to find where is really small
-        for (int i = 0; i < dist.size(); i++) {
-            float this_dist = dynamic_laser_scan.ranges.at(i);
+        // Search outwards from the beam pointing at the pose. A beam that is delta away from the pose bearing
+        // can't be closer than pose_range * sin(delta) (or pose_range past pi/2), so once that bound
+        // passes the best distance found so far, the rest of the scan can be skipped.
+        double pose_range = sqrt(pow(pose.position.x, 2) + pow(pose.position.y, 2));
+        double pose_ori = std::atan2(pose.position.y, pose.position.x);
+        int center_idx = ((int) std::round((pose_ori + M_PI) / scan.angle_increment)) % scan_size;
+
+        const BeamTable& beams = BeamTable::get(-M_PI, scan.angle_increment, scan_size);
+
+        min_dist = std::numeric_limits<double>::infinity();
+        int min_dist_idx = 0;
+        float x, y;
+        auto checkBeam = [&](int i) {
+            float this_dist = scan.ranges[i];
             this_dist = this_dist == 5 ? this_dist + cfg_->traj.rmax : this_dist;
-            dist.at(i) = dist2Pose(i * dynamic_laser_scan.angle_increment - M_PI, this_dist, pose);
-        }
+            beams.toCartesian(i, this_dist, x, y);
+            double dist = sqrt(pow(pose.position.x - x, 2) + pow(pose.position.y - y, 2));
+            // ties go to the lower index, like a full min_element sweep
+            if (dist < min_dist || (dist == min_dist && i < min_dist_idx)) {
+                min_dist = dist;
+                min_dist_idx = i;
+            }
+        };
 
-        auto iter = std::min_element(dist.begin(), dist.end());
-        int min_dist_index = std::distance(dist.begin(), iter);
-        return min_dist_index;
+        checkBeam(center_idx);
+        double offset_angle, bound;
+        for (int offset = 1; offset <= scan_size / 2; offset++) {
+            // center beam can be up to half an increment off of the pose bearing
+            offset_angle = (offset - 0.5) * scan.angle_increment;
+            bound = (offset_angle < M_PI / 2) ? pose_range * std::sin(offset_angle) : pose_range;
+            if (bound > min_dist + 1e-4) {
+                break;
+            }
+            checkBeam((center_idx + offset) % scan_size);
+            checkBeam((center_idx - offset + scan_size) % scan_size);
+        }
+        return min_dist_idx;
     }
 
     double TrajectoryArbiter::dynamicScorePose(geometry_msgs::Pose pose, double theta, double range) {
@@ -533,37 +653,11 @@ namespace dynamic_gap {
         return cost;
     }
 
-    double TrajectoryArbiter::scorePose(geometry_msgs::Pose pose) {
-        boost::mutex::scoped_lock lock(egocircle_mutex);
-        sensor_msgs::LaserScan stored_scan = *msg.get();
-
-        // obtain orientation and idx of pose
-        //double pose_ori = std::atan2(pose.position.y + 1e-3, pose.position.x + 1e-3);
-        //int center_idx = (int) std::round((pose_ori + M_PI) / msg.get()->angle_increment);
-        
-        int scan_size = (int) stored_scan.ranges.size();
-        // dist is size of scan
-        std::vector<double> dist(scan_size);
-
-        // This size **should** be ensured
-        if (stored_scan.ranges.size() < 500) {
-            ROS_FATAL_STREAM("Scan range incorrect scorePose");
-        }
-
-        // iterate through ranges and obtain the distance from the egocircle point and the pose
-        // Meant to find where is really small
-        for (int i = 0; i < dist.size(); i++) {
-            float this_dist = stored_scan.ranges.at(i);
-            this_dist = this_dist == 5 ? this_dist + cfg_->traj.rmax : this_dist;
-            dist.at(i) = dist2Pose(i * stored_scan.angle_increment - M_PI,
-                this_dist, pose);
-        }
-
-        auto iter = std::min_element(dist.begin(), dist.end());
-        //std::cout << "closest point: (" << x << ", " << y << "), robot pose: " << pose.position.x << ", " << pose.position.y << ")" << std::endl;
-        double cost = chapterScore(*iter);
-        //std::cout << *iter << ", regular cost: " << cost << std::endl;
-        // std::cout << "static cost: " << cost << ", robot pose: " << pose.position.x << ", " << pose.position.y << ", closest position: " << range * std::cos(theta) << ", " << range * std::sin(theta) << std::endl;
+    double TrajectoryArbiter::scorePose(geometry_msgs::Pose pose, const sensor_msgs::LaserScan& stored_scan) {
+        double min_dist;
+        nearestEgocircleIndex(pose, stored_scan, min_dist);
+        double cost = chapterScore(min_dist);
+        //std::cout << min_dist << ", regular cost: " << cost << std::endl;
         return cost;
     }
 
@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <dynamic_gap/beam_intersection.h>
+#include <Eigen/Core>
+#include <chrono>
+#include <cmath>
+#include <random>
+#include <vector>
+
+namespace {
+    int sgn_star(float dy) {
+        return (dy < 0) ? -1 : 1;
+    }
+
+    // The per-beam double precision Eigen routine intersectBeam replaced (TrajectoryArbiter::intersectAgentWithBeam),
+    // kept here as the reference the kernel is checked and timed against
+    void referenceIntersectBeam(double rad, double dist, double agent_x, double agent_y, double r_inscr, float& range) {
+        Eigen::Vector2d pt2, centered_pt1, centered_pt2, dx_dy, intersection0, intersection1,
+                        int0_min_cent_pt1, int0_min_cent_pt2, int1_min_cent_pt1, int1_min_cent_pt2,
+                        cent_pt2_min_cent_pt1;
+        double dx, dy, dr, D, discriminant, dist0, dist1;
+
+        pt2 << dist*cos(rad), dist*sin(rad);
+        centered_pt1 << -agent_x, -agent_y;
+        centered_pt2 << pt2[0] - agent_x, pt2[1] - agent_y;
+
+        dx = centered_pt2[0] - centered_pt1[0];
+        dy = centered_pt2[1] - centered_pt1[1];
+        dx_dy << dx, dy;
+        dr = dx_dy.norm();
+
+        D = centered_pt1[0]*centered_pt2[1] - centered_pt2[0]*centered_pt1[1];
+        discriminant = pow(r_inscr,2) * pow(dr, 2) - pow(D, 2);
+
+        if (discriminant > 0) {
+            intersection0 << (D*dy + sgn_star(dy) * dx * sqrt(discriminant)) / pow(dr, 2),
+                             (-D * dx + std::abs(dy)*sqrt(discriminant)) / pow(dr, 2);
+            intersection1 << (D*dy - sgn_star(dy) * dx * sqrt(discriminant)) / pow(dr, 2),
+                             (-D * dx - std::abs(dy)*sqrt(discriminant)) / pow(dr, 2);
+            int0_min_cent_pt1 = intersection0 - centered_pt1;
+            int1_min_cent_pt1 = intersection1 - centered_pt1;
+            cent_pt2_min_cent_pt1 = centered_pt2 - centered_pt1;
+
+            dist0 = int0_min_cent_pt1.norm();
+            dist1 = int1_min_cent_pt1.norm();
+
+            if (dist0 < dist1) {
+                int0_min_cent_pt2 = intersection0 - centered_pt2;
+                if (dist0 < range && dist0 < cent_pt2_min_cent_pt1.norm() && int0_min_cent_pt2.norm() < cent_pt2_min_cent_pt1.norm()) {
+                    range = dist0;
+                }
+            } else {
+                int1_min_cent_pt2 = intersection1 - centered_pt2;
+                if (dist1 < range && dist1 < cent_pt2_min_cent_pt1.norm() && int1_min_cent_pt2.norm() < cent_pt2_min_cent_pt1.norm()) {
+                    range = dist1;
+                }
+            }
+        }
+    }
+
+    // 512 beam egocircle with random static ranges, and random agents around the robot
+    struct BeamScene {
+        int num_beams;
+        double angle_min, angle_increment, r_inscr;
+        std::vector<double> angles;
+        std::vector<float> cos_b, sin_b, base;
+        std::vector<Eigen::Vector2d> agents;
+
+        BeamScene(int num_agents, unsigned seed) : num_beams(512), angle_min(-M_PI), r_inscr(0.2) {
+            angle_increment = 2 * M_PI / num_beams;
+            std::mt19937 gen(seed);
+            std::uniform_real_distribution<double> range_dist(0.3, 5.0), agent_dist(-4.0, 4.0);
+            for (int i = 0; i < num_beams; i++) {
+                angles.push_back(angle_min + i * angle_increment);
+                cos_b.push_back((float) std::cos(angles[i]));
+                sin_b.push_back((float) std::sin(angles[i]));
+                base.push_back((float) range_dist(gen));
+            }
+            for (int j = 0; j < num_agents; j++) {
+                agents.push_back(Eigen::Vector2d(agent_dist(gen), agent_dist(gen)));
+            }
+        }
+    };
+}
+
+// Every beam of every agent against the reference, run on whichever path DYNAMIC_GAP_SIMD compiled in
+TEST(BeamIntersection, MatchesReference) {
+    BeamScene scene(20000, 1);
+    int hits = 0, mismatched_hits = 0;
+    double max_diff = 0.0;
+    std::vector<float> out(scene.num_beams), ref(scene.num_beams);
+    for (const Eigen::Vector2d & agent : scene.agents) {
+        out = scene.base;
+        ref = scene.base;
+        dynamic_gap::intersectAgentWithBeams((float) agent[0], (float) agent[1], (float) scene.r_inscr,
+                                             scene.cos_b.data(), scene.sin_b.data(), scene.base.data(), out.data(),
+                                             0, scene.num_beams);
+        for (int i = 0; i < scene.num_beams; i++) {
+            referenceIntersectBeam(scene.angles[i], scene.base[i], agent[0], agent[1], scene.r_inscr, ref[i]);
+            bool out_hit = out[i] != scene.base[i];
+            bool ref_hit = ref[i] != scene.base[i];
+            hits += ref_hit;
+            mismatched_hits += (out_hit != ref_hit);
+            max_diff = std::max(max_diff, (double) std::abs(out[i] - ref[i]));
+        }
+    }
+    RecordProperty("kernel", dynamic_gap::beamIntersectionKernel());
+    ASSERT_GT(hits, 0);
+    EXPECT_EQ(mismatched_hits, 0);
+    EXPECT_LT(max_diff, 1e-4);
+}
+
+// Split calls over [begin, end) give the same bits as one call over the whole scan, vector tails included
+TEST(BeamIntersection, SpansMatchFullScan) {
+    BeamScene scene(200, 2);
+    std::vector<float> full(scene.num_beams), spans(scene.num_beams);
+    for (const Eigen::Vector2d & agent : scene.agents) {
+        full = scene.base;
+        spans = scene.base;
+        dynamic_gap::intersectAgentWithBeams((float) agent[0], (float) agent[1], (float) scene.r_inscr,
+                                             scene.cos_b.data(), scene.sin_b.data(), scene.base.data(), full.data(),
+                                             0, scene.num_beams);
+        for (int begin = 0; begin < scene.num_beams; begin += 37) {
+            dynamic_gap::intersectAgentWithBeams((float) agent[0], (float) agent[1], (float) scene.r_inscr,
+                                                 scene.cos_b.data(), scene.sin_b.data(), scene.base.data(), spans.data(),
+                                                 begin, std::min(begin + 37, scene.num_beams));
+        }
+        for (int i = 0; i < scene.num_beams; i++) {
+            ASSERT_EQ(full[i], spans[i]) << "beam " << i;
+        }
+    }
+}
+
+// Time per agent over a full scan for the reference and the compiled-in kernel, reported as test properties
+TEST(BeamIntersection, Benchmark) {
+    BeamScene scene(2000, 3);
+    std::vector<float> out(scene.num_beams);
+    float checksum = 0.0;
+
+    auto start = std::chrono::steady_clock::now();
+    for (const Eigen::Vector2d & agent : scene.agents) {
+        out = scene.base;
+        for (int i = 0; i < scene.num_beams; i++) {
+            referenceIntersectBeam(scene.angles[i], scene.base[i], agent[0], agent[1], scene.r_inscr, out[i]);
+        }
+        checksum += out[0];
+    }
+    double reference_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    start = std::chrono::steady_clock::now();
+    for (const Eigen::Vector2d & agent : scene.agents) {
+        out = scene.base;
+        dynamic_gap::intersectAgentWithBeams((float) agent[0], (float) agent[1], (float) scene.r_inscr,
+                                             scene.cos_b.data(), scene.sin_b.data(), scene.base.data(), out.data(),
+                                             0, scene.num_beams);
+        checksum += out[0];
+    }
+    double kernel_us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - start).count();
+
+    int num_agents = scene.agents.size();
+    RecordProperty("reference_ns_per_agent", (int) (1000.0 * reference_us / num_agents));
+    RecordProperty("kernel_ns_per_agent", (int) (1000.0 * kernel_us / num_agents));
+    std::cout << dynamic_gap::beamIntersectionKernel() << ": " << kernel_us / num_agents << " us per agent, reference "
+              << reference_us / num_agents << " us per agent" << std::endl;
+    EXPECT_TRUE(std::isfinite(checksum));
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
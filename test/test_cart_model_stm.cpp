@@ -0,0 +1,96 @@
+#include <gtest/gtest.h>
+#include <dynamic_gap/cart_model.h>
+#include <Eigen/Core>
+#include <unsupported/Eigen/MatrixFunctions>
+#include <cmath>
+#include <vector>
+
+using namespace Eigen;
+
+namespace {
+    // Runs linearize() and discretizeQ() for a step of exactly dt at ego angular velocity w, with linear ego
+    // accelerations (acc_x, acc_y) setting the velocity process noise
+    void stepModel(dynamic_gap::cart_model & model, double w, double dt, double acc_x, double acc_y) {
+        std::vector<std::vector<double>> no_agents;
+        Matrix<double, 2, 1> measurement(2.0, 0.5);
+        Matrix<double, 1, 3> a_ego(acc_x, acc_y, 0.0), v_ego(0.3, 0.1, w);
+        // the previous update at t = 0, so that dt comes out exact
+        model.begin_update(measurement, a_ego, v_ego, false, no_agents, no_agents, 0.0);
+        model.end_update();
+        model.begin_update(measurement, a_ego, v_ego, false, no_agents, no_agents, dt);
+        model.linearize();
+        model.discretizeQ();
+    }
+
+    // Van Loan: exp([-A Q; 0 A^T] dt) = [. F^-1 dQ; 0 F^T] with F = exp(A dt)
+    Matrix<double, 4, 4> vanLoanDQ(const Matrix<double, 4, 4> & A, const Matrix<double, 4, 4> & Q, double dt) {
+        Matrix<double, 8, 8> M = Matrix<double, 8, 8>::Zero();
+        M.block<4, 4>(0, 0) = -A;
+        M.block<4, 4>(0, 4) = Q;
+        M.block<4, 4>(4, 4) = A.transpose();
+        Matrix<double, 8, 8> E = (M * dt).exp();
+        return E.block<4, 4>(4, 4).transpose() * E.block<4, 4>(0, 4);
+    }
+
+    void expectMatchesReference(dynamic_gap::cart_model & model, double w, double dt, double acc_x, double acc_y) {
+        stepModel(model, w, dt, acc_x, acc_y);
+        const Matrix<double, 4, 4> & A = model.get_A();
+
+        Matrix<double, 4, 4> STM_ref = (A * dt).exp();
+        EXPECT_LT((model.get_STM() - STM_ref).cwiseAbs().maxCoeff(), 1e-12)
+            << "w " << w << ", dt " << dt;
+
+        Matrix<double, 4, 4> dQ_ref = vanLoanDQ(A, model.get_Q(), dt);
+        EXPECT_LT((model.get_dQ() - dQ_ref).cwiseAbs().maxCoeff(), 1e-11 * dQ_ref.cwiseAbs().maxCoeff())
+            << "w " << w << ", dt " << dt << ", 2 w dt " << 2 * w * dt;
+    }
+}
+
+// w from -5 to 10 rad/s and dt from 1e-4 to 1 s, which covers both the power series (|2 w dt| < 1)
+// and the closed form, with the larger process noise on either axis
+TEST(CartModelSTM, MatchesMatrixExponentialSweep) {
+    dynamic_gap::cart_model model("left", 0, 2.0, 0.5, Matrix<double, 1, 3>(0.3, 0.1, 0.0));
+    std::vector<double> dts = {1e-4, 1e-3, 1e-2, 0.05, 0.1, 0.2, 0.5, 1.0};
+    int series = 0, closed_form = 0;
+    for (double w = -5.0; w <= 10.0; w += 0.25) {
+        for (double dt : dts) {
+            (std::abs(2 * w * dt) < 1.0) ? series++ : closed_form++;
+            expectMatchesReference(model, w, dt, 1.0, 0.2);
+            expectMatchesReference(model, w, dt, 0.2, 1.0);
+        }
+    }
+    EXPECT_GT(series, 0);
+    EXPECT_GT(closed_form, 0);
+}
+
+// No rotation at all, where the closed form would divide by zero
+TEST(CartModelSTM, ZeroAngularVelocity) {
+    dynamic_gap::cart_model model("left", 0, 2.0, 0.5, Matrix<double, 1, 3>(0.3, 0.1, 0.0));
+    expectMatchesReference(model, 0.0, 0.1, 1.0, 0.2);
+}
+
+// Either side of |2 w dt| = 1, where the series hands over to the closed form: both match the reference,
+// and dQ is continuous across the switch
+TEST(CartModelSTM, SeriesSwitchOver) {
+    dynamic_gap::cart_model model("left", 0, 2.0, 0.5, Matrix<double, 1, 3>(0.3, 0.1, 0.0));
+    for (double dt : {0.05, 0.1, 0.5}) {
+        for (double sign : {-1.0, 1.0}) {
+            double w_switch = sign / (2.0 * dt);
+            double w_below = w_switch * (1.0 - 1e-9), w_above = w_switch * (1.0 + 1e-9);
+
+            expectMatchesReference(model, w_below, dt, 1.0, 0.2);
+            Matrix<double, 4, 4> dQ_below = model.get_dQ();
+            expectMatchesReference(model, w_above, dt, 1.0, 0.2);
+            Matrix<double, 4, 4> dQ_above = model.get_dQ();
+
+            EXPECT_LT((dQ_below - dQ_above).cwiseAbs().maxCoeff(), 1e-8 * dQ_below.cwiseAbs().maxCoeff())
+                << "dt " << dt << ", w " << w_switch;
+        }
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    ros::Time::init();
+    return RUN_ALL_TESTS();
+}
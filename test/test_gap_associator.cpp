@@ -0,0 +1,170 @@
+#include <gtest/gtest.h>
+#include <dynamic_gap/gap_associator.h>
+#include <dynamic_gap/dist_matrix.h>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <set>
+#include <vector>
+
+namespace dynamic_gap {
+    // SolveGated against the Hungarian solver (Solve) on the same problem: every row may also take a private
+    // dummy column at cost assoc_thresh, which is how SolveGated leaves a row unassigned
+    class GapAssociatorSolverTest : public ::testing::Test {
+        protected:
+            GapAssociatorSolverTest() : associator(cfg) {};
+
+            // distances above thresh are gated out (infinity), as gateDistMatrix leaves them
+            std::vector<int> solveGated(const DistMatrix& distMatrix, double thresh) {
+                associator.assoc_thresh = thresh;
+                associator.gated = true;
+                associator.candidate_start.assign(1, 0);
+                associator.candidate_cols.clear();
+                for (int i = 0; i < distMatrix.rows(); i++) {
+                    for (int j = 0; j < distMatrix.cols(); j++) {
+                        if (distMatrix(i, j) <= thresh) {
+                            associator.candidate_cols.push_back(j);
+                        }
+                    }
+                    associator.candidate_start.push_back(associator.candidate_cols.size());
+                }
+                std::vector<int> assignment;
+                associator.SolveGated(distMatrix, assignment);
+                return assignment;
+            }
+
+            // Hungarian on [distances | diag(thresh)], gated out pairs and other rows' dummies at a prohibitive cost
+            std::vector<int> solveDummyHungarian(const DistMatrix& distMatrix, double thresh) {
+                int nRows = distMatrix.rows(), nCols = distMatrix.cols();
+                double prohibitive = 1e6;
+                DistMatrix extended;
+                extended.resize(nRows, nCols + nRows);
+                for (int i = 0; i < nRows; i++) {
+                    for (int j = 0; j < nCols + nRows; j++) {
+                        if (j < nCols) {
+                            extended(i, j) = (distMatrix(i, j) <= thresh) ? distMatrix(i, j) : prohibitive;
+                        } else {
+                            extended(i, j) = (j == nCols + i) ? thresh : prohibitive;
+                        }
+                    }
+                }
+                std::vector<int> assignment;
+                associator.Solve(extended, assignment);
+                for (int & j : assignment) {
+                    if (j >= nCols) {
+                        j = -1;
+                    }
+                }
+                return assignment;
+            }
+
+            static double assignmentCost(const DistMatrix& distMatrix, double thresh, const std::vector<int>& assignment) {
+                double cost = 0.0;
+                for (int i = 0; i < (int) assignment.size(); i++) {
+                    cost += (assignment[i] >= 0) ? distMatrix(i, assignment[i]) : thresh;
+                }
+                return cost;
+            }
+
+            // one row per entry, every column used at most once, only pairs within thresh
+            static void expectValid(const DistMatrix& distMatrix, double thresh, const std::vector<int>& assignment) {
+                ASSERT_EQ((int) assignment.size(), distMatrix.rows());
+                std::set<int> used;
+                for (int i = 0; i < (int) assignment.size(); i++) {
+                    int j = assignment[i];
+                    if (j < 0) {
+                        continue;
+                    }
+                    ASSERT_LT(j, distMatrix.cols());
+                    EXPECT_LE(distMatrix(i, j), thresh) << "row " << i << " took gated out column " << j;
+                    EXPECT_TRUE(used.insert(j).second) << "column " << j << " assigned twice";
+                }
+            }
+
+            void expectMatchesHungarian(const DistMatrix& distMatrix, double thresh) {
+                std::vector<int> gated = solveGated(distMatrix, thresh);
+                std::vector<int> reference = solveDummyHungarian(distMatrix, thresh);
+                expectValid(distMatrix, thresh, gated);
+                // ties can pick different assignments, the optimal cost is unique
+                EXPECT_NEAR(assignmentCost(distMatrix, thresh, gated), assignmentCost(distMatrix, thresh, reference), 1e-9)
+                    << distMatrix.rows() << " x " << distMatrix.cols();
+            }
+
+            // rows x cols distances drawn by draw, above thresh gated out, and some rows with no candidates at all
+            template <class Draw>
+            static void randomInstance(std::mt19937& gen, int rows, int cols, double thresh, Draw draw, DistMatrix& distMatrix) {
+                std::bernoulli_distribution empty_row(0.15);
+                double inf = std::numeric_limits<double>::infinity();
+                distMatrix.resize(rows, cols);
+                for (int i = 0; i < rows; i++) {
+                    bool empty = empty_row(gen);
+                    for (int j = 0; j < cols; j++) {
+                        double d = draw(gen);
+                        distMatrix(i, j) = (empty || d > thresh) ? inf : d;
+                    }
+                }
+            }
+
+            DynamicGapConfig cfg;
+            GapAssociator associator;
+    };
+
+    TEST_F(GapAssociatorSolverTest, RandomInstances) {
+        std::mt19937 gen(7);
+        std::uniform_int_distribution<int> size(1, 12);
+        double thresh = 0.5;
+        std::uniform_real_distribution<double> continuous(0.0, 2.0 * thresh);
+        DistMatrix distMatrix;
+        for (int instance = 0; instance < 2000; instance++) {
+            randomInstance(gen, size(gen), size(gen), thresh, continuous, distMatrix);
+            expectMatchesHungarian(distMatrix, thresh);
+        }
+    }
+
+    // distances on a coarse grid, so many assignments tie, including pairs that cost exactly the dummy
+    TEST_F(GapAssociatorSolverTest, RandomInstancesWithTies) {
+        std::mt19937 gen(11);
+        std::uniform_int_distribution<int> size(1, 12), step(0, 8);
+        double thresh = 0.5;
+        auto coarse = [&](std::mt19937& g) { return 0.125 * step(g); };
+        DistMatrix distMatrix;
+        for (int instance = 0; instance < 2000; instance++) {
+            randomInstance(gen, size(gen), size(gen), thresh, coarse, distMatrix);
+            expectMatchesHungarian(distMatrix, thresh);
+        }
+    }
+
+    TEST_F(GapAssociatorSolverTest, NoCandidates) {
+        double inf = std::numeric_limits<double>::infinity();
+        DistMatrix distMatrix;
+        distMatrix.resize(4, 3);
+        for (int i = 0; i < 4; i++) {
+            for (int j = 0; j < 3; j++) {
+                distMatrix(i, j) = inf;
+            }
+        }
+        EXPECT_EQ(solveGated(distMatrix, 0.5), std::vector<int>(4, -1));
+
+        distMatrix.resize(3, 0);
+        EXPECT_EQ(solveGated(distMatrix, 0.5), std::vector<int>(3, -1));
+    }
+
+    // two rows competing for the same column, the cheaper total leaves the far row unassigned
+    TEST_F(GapAssociatorSolverTest, CompetingRows) {
+        double inf = std::numeric_limits<double>::infinity();
+        DistMatrix distMatrix;
+        distMatrix.resize(2, 2);
+        distMatrix(0, 0) = 0.1; distMatrix(0, 1) = 0.2;
+        distMatrix(1, 0) = 0.15; distMatrix(1, 1) = inf;
+        EXPECT_EQ(solveGated(distMatrix, 0.5), std::vector<int>({1, 0}));
+
+        distMatrix(0, 1) = inf;
+        std::vector<int> assignment = solveGated(distMatrix, 0.5);
+        EXPECT_EQ(assignment, std::vector<int>({0, -1}));
+    }
+}
+
+int main(int argc, char **argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}